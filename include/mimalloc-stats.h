@@ -63,6 +63,9 @@ typedef struct mi_stat_counter_s {
   MI_STAT_COUNTER(pages_reclaim_on_free) \
   MI_STAT_COUNTER(pages_reabandon_full) \
   MI_STAT_COUNTER(pages_unabandon_busy_wait) \
+  /* numa (v2) */ \
+  MI_STAT_COUNT(segments_numa_local)        /* bytes in segments on the numa node of the requesting thread (or heap) */ \
+  MI_STAT_COUNT(segments_numa_remote)       /* bytes in segments on another numa node */ \
 
 
 // Define the statistics structure
@@ -77,7 +80,7 @@ typedef struct mi_stats_s
   MI_STAT_FIELDS()
 
   // future extension
-  mi_stat_count_t   _stat_reserved[4];
+  mi_stat_count_t   _stat_reserved[2];
   mi_stat_counter_t _stat_counter_reserved[4];
 
   // size segregated statistics
@@ -88,6 +91,21 @@ typedef struct mi_stats_s
 #undef MI_STAT_COUNT
 #undef MI_STAT_COUNTER
 
+// Fragmentation of the pages of a size bin (computed from the page counters without visiting blocks)
+typedef struct mi_frag_bin_s {
+  size_t block_size;                          // block size of the bin (for the huge bin only the nominal size)
+  size_t page_count;                          // pages in use for this bin
+  size_t reserved;                            // blocks reserved in those pages
+  size_t capacity;                            // blocks available (committed) in those pages
+  size_t used;                                // blocks in use
+  size_t committed;                           // committed bytes (capacity × block size)
+  size_t wasted;                              // committed bytes not in use (committed - used × block size)
+} mi_frag_bin_t;
+
+typedef struct mi_frag_info_s {
+  mi_frag_bin_t bins[MI_BIN_HUGE+1];
+} mi_frag_info_t;
+
 // Exported definitions
 #ifdef __cplusplus
 extern "C" {
@@ -96,6 +114,9 @@ extern "C" {
 mi_decl_export void  mi_stats_get( size_t stats_size, mi_stats_t* stats ) mi_attr_noexcept;
 mi_decl_export char* mi_stats_get_json( size_t buf_size, char* buf ) mi_attr_noexcept;    // use mi_free to free the result if the input buf == NULL
 
+mi_decl_export void  mi_heap_fragmentation_get( mi_heap_t* heap, mi_frag_info_t* info ) mi_attr_noexcept;
+mi_decl_export void  mi_fragmentation_get( mi_frag_info_t* info ) mi_attr_noexcept;  // for all heaps of the current thread (as heaps are thread-local)
+
 #ifdef __cplusplus
 }
 #endif
@@ -134,6 +134,11 @@ mi_decl_nodiscard mi_decl_export void* mi_reallocf(void* p, size_t newsize)
 mi_decl_nodiscard mi_decl_export size_t mi_usable_size(const void* p) mi_attr_noexcept;
 mi_decl_nodiscard mi_decl_export size_t mi_good_size(size_t size)     mi_attr_noexcept;
 
+// Allocate `count` blocks of `size` bytes into `out` at once; returns the number of blocks allocated (less than `count` only when out of memory)
+mi_decl_nodiscard mi_decl_export size_t mi_malloc_batch(size_t size, size_t count, void** out) mi_attr_noexcept;
+mi_decl_nodiscard mi_decl_export size_t mi_zalloc_batch(size_t size, size_t count, void** out) mi_attr_noexcept;
+mi_decl_export void mi_free_batch(void** ptrs, size_t n) mi_attr_noexcept;  // note: reorders the `ptrs` array
+
 
 // ------------------------------------------------------
 // Internals
@@ -164,6 +169,7 @@ mi_decl_export void mi_thread_stats_print_out(mi_output_fun* out, void* arg) mi_
 mi_decl_export void mi_process_info(size_t* elapsed_msecs, size_t* user_msecs, size_t* system_msecs,
                                     size_t* current_rss, size_t* peak_rss,
                                     size_t* current_commit, size_t* peak_commit, size_t* page_faults) mi_attr_noexcept;
+mi_decl_export size_t mi_process_thp_size(void) mi_attr_noexcept;   // bytes backed by transparent huge pages (or 0 if unknown)
 
 // -------------------------------------------------------------------------------------
 // Aligned allocation
@@ -201,6 +207,8 @@ mi_decl_nodiscard mi_decl_export mi_decl_restrict void* mi_heap_zalloc(mi_heap_t
 mi_decl_nodiscard mi_decl_export mi_decl_restrict void* mi_heap_calloc(mi_heap_t* heap, size_t count, size_t size) mi_attr_noexcept mi_attr_malloc mi_attr_alloc_size2(2, 3);
 mi_decl_nodiscard mi_decl_export mi_decl_restrict void* mi_heap_mallocn(mi_heap_t* heap, size_t count, size_t size) mi_attr_noexcept mi_attr_malloc mi_attr_alloc_size2(2, 3);
 mi_decl_nodiscard mi_decl_export mi_decl_restrict void* mi_heap_malloc_small(mi_heap_t* heap, size_t size) mi_attr_noexcept mi_attr_malloc mi_attr_alloc_size(2);
+mi_decl_nodiscard mi_decl_export size_t mi_heap_malloc_batch(mi_heap_t* heap, size_t size, size_t count, void** out) mi_attr_noexcept;
+mi_decl_nodiscard mi_decl_export size_t mi_heap_zalloc_batch(mi_heap_t* heap, size_t size, size_t count, void** out) mi_attr_noexcept;
 
 mi_decl_nodiscard mi_decl_export void* mi_heap_realloc(mi_heap_t* heap, void* p, size_t newsize)              mi_attr_noexcept mi_attr_alloc_size(3);
 mi_decl_nodiscard mi_decl_export void* mi_heap_reallocn(mi_heap_t* heap, void* p, size_t count, size_t size)  mi_attr_noexcept mi_attr_alloc_size2(3,4);
@@ -267,12 +275,23 @@ typedef bool (mi_cdecl mi_block_visit_fun)(const mi_heap_t* heap, const mi_heap_
 
 mi_decl_export bool mi_heap_visit_blocks(const mi_heap_t* heap, bool visit_blocks, mi_block_visit_fun* visitor, void* arg);
 
+// Defragmentation: move live blocks out of pages that are used below a `ratio` (like 0.5) of their capacity.
+// The move function should allocate a new block in the heap, copy the contents, update all references, and free the old block.
+// `mi_heap_page_is_underutilized` returns `false` for pointers outside mimalloc memory or in a page of another heap.
+typedef bool (mi_cdecl mi_block_move_fun)(const mi_heap_t* heap, void* block, size_t block_size, void* arg);
+
+mi_decl_export bool   mi_heap_page_is_underutilized(mi_heap_t* heap, const void* p, double ratio);
+mi_decl_export size_t mi_heap_defrag(mi_heap_t* heap, double ratio, mi_block_move_fun* move, void* arg);
+
 // Experimental
 mi_decl_nodiscard mi_decl_export bool mi_is_in_heap_region(const void* p) mi_attr_noexcept;
 mi_decl_nodiscard mi_decl_export bool mi_is_redirected(void) mi_attr_noexcept;
 
 mi_decl_export int   mi_reserve_huge_os_pages_interleave(size_t pages, size_t numa_nodes, size_t timeout_msecs) mi_attr_noexcept;
 mi_decl_export int   mi_reserve_huge_os_pages_at(size_t pages, int numa_node, size_t timeout_msecs) mi_attr_noexcept;
+mi_decl_export int   mi_reserve_huge_os_pages_interleave_async(size_t pages, size_t numa_nodes, size_t timeout_msecs) mi_attr_noexcept;
+mi_decl_export int   mi_reserve_huge_os_pages_at_async(size_t pages, int numa_node, size_t timeout_msecs) mi_attr_noexcept;
+mi_decl_export bool  mi_reserve_huge_os_pages_async_is_done(size_t* pages_reserved, int* err) mi_attr_noexcept;
 
 mi_decl_export int   mi_reserve_os_memory(size_t size, bool commit, bool allow_large) mi_attr_noexcept;
 mi_decl_export bool  mi_manage_os_memory(void* start, size_t size, bool is_committed, bool is_large, bool is_zero, int numa_node) mi_attr_noexcept;
@@ -286,6 +305,7 @@ mi_decl_export void* mi_arena_area(mi_arena_id_t arena_id, size_t* size);
 mi_decl_export int   mi_reserve_huge_os_pages_at_ex(size_t pages, int numa_node, size_t timeout_msecs, bool exclusive, mi_arena_id_t* arena_id) mi_attr_noexcept;
 mi_decl_export int   mi_reserve_os_memory_ex(size_t size, bool commit, bool allow_large, bool exclusive, mi_arena_id_t* arena_id) mi_attr_noexcept;
 mi_decl_export bool  mi_manage_os_memory_ex(void* start, size_t size, bool is_committed, bool is_large, bool is_zero, int numa_node, bool exclusive, mi_arena_id_t* arena_id) mi_attr_noexcept;
+mi_decl_export int   mi_arena_prefault(mi_arena_id_t arena_id, size_t nthreads) mi_attr_noexcept;
 
 #if MI_MALLOC_VERSION >= 182
 // Create a heap that only allocates in the specified arena
@@ -318,6 +338,40 @@ mi_decl_export void mi_thread_set_in_threadpool(void) mi_attr_noexcept;
 // fall back to `mi_heap_delete`.
 mi_decl_nodiscard mi_decl_export mi_heap_t* mi_heap_new_ex(int heap_tag, bool allow_destroy, mi_arena_id_t arena_id);
 
+// Experimental: limit the total size of the pages owned by a heap to `limit` bytes (use 0 for no limit).
+// When an allocation would exceed the limit, `fun` is called (if not NULL). It can release memory and
+// return `true` to retry the allocation, or return `false` to let the allocation fail with NULL.
+// The size of the pages is the memory reserved by the heap (which is not necessarily all committed); see `mi_heap_get_reserved`.
+typedef bool (mi_cdecl mi_heap_limit_fun)(mi_heap_t* heap, size_t limit, size_t reserved, size_t size, void* arg);
+mi_decl_export void   mi_heap_set_limit(mi_heap_t* heap, size_t limit, mi_heap_limit_fun* fun, void* arg);
+mi_decl_export size_t mi_heap_get_reserved(mi_heap_t* heap);
+
+// Experimental: warm up a heap by adding fresh pages for blocks of `size` until at least `nblocks` such blocks can be
+// allocated without taking a fresh page from a segment or calling the OS. The pages are committed and pre-faulted.
+// Only supported for small and medium sizes, and only from the thread that owns the heap. Returns 0 on success, or
+// `EINVAL`/`ENOMEM` on failure. Note that a collection of the heap can release pages that are still completely free.
+mi_decl_export int    mi_heap_reserve(mi_heap_t* heap, size_t size, size_t nblocks) mi_attr_noexcept;
+
+// Experimental: create a new monotonic heap that allocates small and medium objects by bumping a pointer through fresh pages.
+// Freeing a block of a monotonic heap is a no-op; all memory is released at once with `mi_heap_destroy`.
+mi_decl_nodiscard mi_decl_export mi_heap_t* mi_heap_new_monotonic(void);
+
+// Experimental: create a new heap that prefers memory (arenas and abandoned segments) from the given NUMA node.
+// With `mi_option_arena_numa_bind` enabled, arenas that are reserved on demand for this heap are bound to that node.
+// The heap can reclaim abandoned memory so `mi_heap_destroy` falls back to `mi_heap_delete`.
+mi_decl_nodiscard mi_decl_export mi_heap_t* mi_heap_new_on_node(int numa_node);
+
+// Experimental: write the sampled heap profile to the file `fname` (only when building with `MI_PROFILE=ON`, see
+// `mi_option_profile_sample_rate`). Writes the live profile of samples that are at least `min_age_msecs` old, or
+// the `cumulative` profile of all sampled allocations. Stack frames are written as unsymbolized return addresses.
+// Returns 0 on success, `ENOTSUP` if profiling is not compiled in, or an `errno` value if the file cannot be written.
+typedef enum mi_profile_format_e {
+  mi_profile_format_pprof,      // legacy `pprof` heap profile (gperftools heap_v2 text format)
+  mi_profile_format_collapsed   // collapsed stacks with estimated bytes (as used by `flamegraph.pl`)
+} mi_profile_format_t;
+
+mi_decl_export int mi_profile_dump(const char* fname, mi_profile_format_t format, bool cumulative, size_t min_age_msecs) mi_attr_noexcept;
+
 // deprecated
 mi_decl_export int mi_reserve_huge_os_pages(size_t pages, double max_secs, size_t* pages_reserved) mi_attr_noexcept;
 mi_decl_export void mi_collect_reduce(size_t target_thread_owned) mi_attr_noexcept;
@@ -387,6 +441,20 @@ typedef enum mi_option_e {
   mi_option_guarded_sample_seed,        // can be set to allow for a (more) deterministic re-execution when a guard page is triggered (=0)
   mi_option_target_segments_per_thread, // experimental (=0)
   mi_option_generic_collect,            // collect heaps every N (=10000) generic allocation calls
+  mi_option_remote_free_buffer,         // buffer up to N frees per page owned by another thread and publish them at once (=0, disabled). Not for use with `mi_heap_destroy`.
+  mi_option_huge_remap,                 // allocate huge blocks in remappable OS memory so `mi_realloc` can resize them without copying (=0, only on Linux)
+  mi_option_soft_memory_limit,          // soft limit (in KiB) on committed memory; purge eagerly when approaching it (=0, use the cgroup memory limit if present)
+  mi_option_memory_pressure_interval,   // check for memory pressure every N milli-seconds (=0, disabled)
+  mi_option_purge_thread,               // do delayed purging of arenas and abandoned segments in a background thread (=0)
+  mi_option_thp_mode,                   // commit and purge segments at 2MiB granularity to keep transparent huge pages intact (=0); use 2 to also collapse dense segments into huge pages
+  mi_option_arena_numa_bind,            // bind arenas that are reserved on demand to the NUMA node of the requesting thread (=0, only with multiple NUMA nodes)
+  mi_option_abandoned_reclaim_numa_tries, // only reclaim abandoned segments from the local NUMA node until N (=4) reclaim attempts in a row failed (-1 = never reclaim remote)
+  mi_option_arena_release_delay,        // release arenas that were reserved on demand back to the OS after being idle for N milli-seconds (=-1, never release)
+  mi_option_os_region_reserve,          // reserve one virtual address range of N KiB at startup to carve all segments and arenas from (=0, disabled) (use `option_get_size`)
+  mi_option_reserve_huge_os_pages_async, // reserve the huge OS pages of `mi_option_reserve_huge_os_pages` in a background thread instead of at startup (=0)
+  mi_option_arena_prefault,             // pre-fault committed memory reserved with `mi_reserve_os_memory(_ex)` using N threads (=0, disabled)
+  mi_option_heap_recycle,               // park the heaps of up to N (=0, max 16) exited threads with their segments for new threads to adopt (instead of abandoning)
+  mi_option_profile_sample_rate,        // only used when building with MI_PROFILE: sample on average once every N KiB allocated bytes (=512 KiB, 0 to disable)
   _mi_option_last,
   // legacy option names
   mi_option_large_os_pages = mi_option_allow_large_os_pages,
@@ -108,12 +108,21 @@ size_t      _mi_current_thread_count(void);
 bool        _mi_preloading(void);           // true while the C runtime is not initialized yet
 void        _mi_thread_done(mi_heap_t* heap);
 void        _mi_thread_data_collect(void);
+void        _mi_heap_recycle_collect(void);
 void        _mi_tld_init(mi_tld_t* tld, mi_heap_t* bheap);
 mi_threadid_t _mi_thread_id(void) mi_attr_noexcept;
 mi_heap_t*    _mi_heap_main_get(void);     // statically allocated main backing heap
 mi_subproc_t* _mi_subproc_from_id(mi_subproc_id_t subproc_id);
 void        _mi_heap_guarded_init(mi_heap_t* heap);
 
+// profile.c
+void        _mi_profile_init(void);
+void        _mi_heap_profile_init(mi_heap_t* heap);
+void        _mi_heap_profile_sample(mi_heap_t* heap, void* p, size_t size);
+void        _mi_profile_free(const mi_block_t* block);
+void        _mi_profile_free_range(const void* start, size_t size);
+void        _mi_profile_resize(const void* p, const void* newp, size_t newsize);
+
 // os.c
 void        _mi_os_init(void);                                            // called from process init
 void*       _mi_os_alloc(size_t size, mi_memid_t* memid);
@@ -133,28 +142,47 @@ bool        _mi_os_protect(void* addr, size_t size);
 bool        _mi_os_unprotect(void* addr, size_t size);
 bool        _mi_os_purge(void* p, size_t size);
 bool        _mi_os_purge_ex(void* p, size_t size, bool allow_reset, size_t stat_size);
+bool        _mi_os_purge_ranges(mi_os_range_t* ranges, size_t count);
+bool        _mi_os_collapse(void* addr, size_t size);
+void        _mi_os_populate(void* addr, size_t size);
+bool        _mi_os_numa_bind(void* addr, size_t size, int numa_node);
 
 void*       _mi_os_alloc_aligned(size_t size, size_t alignment, bool commit, bool allow_large, mi_memid_t* memid);
 void*       _mi_os_alloc_aligned_at_offset(size_t size, size_t alignment, size_t align_offset, bool commit, bool allow_large, mi_memid_t* memid);
+void*       _mi_os_alloc_remappable(size_t size, size_t alignment, mi_memid_t* memid);
+void*       _mi_os_remap(void* p, size_t newsize, size_t alignment, mi_memid_t* memid);
 
 void*       _mi_os_get_aligned_hint(size_t try_alignment, size_t size);
+void        _mi_os_region_init(void);                                     // called from process init
+bool        _mi_os_region_contains(const void* p);
+bool        _mi_os_region_is_inuse(const void* p);
 bool        _mi_os_use_large_page(size_t size, size_t alignment);
 size_t      _mi_os_large_page_size(void);
 
 void*       _mi_os_alloc_huge_os_pages(size_t pages, int numa_node, mi_msecs_t max_secs, size_t* pages_reserved, size_t* psize, mi_memid_t* memid);
 
+bool        _mi_os_memory_pressure_check(bool force);                    // periodically check memory pressure; true if collection is advised
+size_t      _mi_os_memory_pressure(void);                                 // 0: none, 1: moderate, 2: critical
+long        _mi_os_purge_delay(void);                                     // the purge delay adjusted for memory pressure
+
 // arena.c
 mi_arena_id_t _mi_arena_id_none(void);
 void        _mi_arena_free(void* p, size_t size, size_t still_committed_size, mi_memid_t memid);
 void*       _mi_arena_alloc(size_t size, bool commit, bool allow_large, mi_arena_id_t req_arena_id, mi_memid_t* memid);
-void*       _mi_arena_alloc_aligned(size_t size, size_t alignment, size_t align_offset, bool commit, bool allow_large, mi_arena_id_t req_arena_id, mi_memid_t* memid);
+void*       _mi_arena_alloc_aligned(size_t size, size_t alignment, size_t align_offset, bool commit, bool allow_large, mi_arena_id_t req_arena_id, int numa_node, mi_memid_t* memid);
 bool        _mi_arena_memid_is_suitable(mi_memid_t memid, mi_arena_id_t request_arena_id);
+int         _mi_arena_memid_numa_node(mi_memid_t memid);
 bool        _mi_arena_contains(const void* p);
 void        _mi_arenas_collect(bool force_purge);
 void        _mi_arena_unsafe_destroy_all(void);
+void        _mi_purge_thread_start(void);                                 // start the background purge thread (if enabled)
+void        _mi_purge_thread_stop(void);
+bool        _mi_purge_thread_is_active(void);
 
 bool        _mi_arena_segment_clear_abandoned(mi_segment_t* segment);
 void        _mi_arena_segment_mark_abandoned(mi_segment_t* segment);
+void        _mi_arena_segment_mark_abandoned_indexed(mi_segment_t* segment, const uint8_t* buckets, size_t bucket_count);
+mi_segment_t* _mi_arena_segment_clear_abandoned_indexed(mi_subproc_t* subproc, size_t bucket);
 
 void*       _mi_arena_meta_zalloc(size_t size, mi_memid_t* memid);
 void        _mi_arena_meta_free(void* p, mi_memid_t memid, size_t size);
@@ -167,8 +195,13 @@ typedef struct mi_arena_field_cursor_s { // abstract struct
   mi_subproc_t*  subproc;                 // only visit blocks in this sub-process
   bool           visit_all;               // ensure all abandoned blocks are seen (blocking)
   bool           hold_visit_lock;         // if the subproc->abandoned_os_visit_lock is held
+  int            numa_node;               // preferred numa node (if `numa_pass > 0`)
+  int            numa_pass;               // 0: visit all arenas, 1: visit arenas on `numa_node`, 2: visit arenas on other nodes
+  bool           numa_remote;             // visit the arenas on other nodes after the local ones
+  size_t         numa_start;              // start arena idx for the remote pass
 } mi_arena_field_cursor_t;
 void          _mi_arena_field_cursor_init(mi_heap_t* heap, mi_subproc_t* subproc, bool visit_all, mi_arena_field_cursor_t* current);
+void          _mi_arena_field_cursor_prefer_numa(mi_arena_field_cursor_t* current, int numa_node, bool visit_remote);
 mi_segment_t* _mi_arena_segment_clear_abandoned_next(mi_arena_field_cursor_t* previous);
 void          _mi_arena_field_cursor_done(mi_arena_field_cursor_t* current);
 
@@ -181,6 +214,8 @@ void        _mi_segment_map_unsafe_destroy(void);
 mi_page_t* _mi_segment_page_alloc(mi_heap_t* heap, size_t block_size, size_t page_alignment, mi_segments_tld_t* tld);
 void       _mi_segment_page_free(mi_page_t* page, bool force, mi_segments_tld_t* tld);
 void       _mi_segment_page_abandon(mi_page_t* page, mi_segments_tld_t* tld);
+bool       _mi_segment_page_try_grow(mi_page_t* page, size_t block_size, mi_segments_tld_t* tld);
+mi_page_t* _mi_segment_huge_page_remap(mi_page_t* page, size_t size, mi_segments_tld_t* tld);
 bool       _mi_segment_try_reclaim_abandoned( mi_heap_t* heap, bool try_all, mi_segments_tld_t* tld);
 void       _mi_segment_collect(mi_segment_t* segment, bool force);
 
@@ -204,6 +239,7 @@ void        _mi_page_unfull(mi_page_t* page);
 void        _mi_page_free(mi_page_t* page, mi_page_queue_t* pq, bool force);   // free the page
 void        _mi_page_abandon(mi_page_t* page, mi_page_queue_t* pq);            // abandon the page, to be picked up by another thread...
 void        _mi_page_force_abandon(mi_page_t* page);
+mi_page_t*  _mi_page_huge_remap(mi_page_t* page, size_t size);                 // resize a huge page without copying (or return NULL)
 
 void        _mi_heap_delayed_free_all(mi_heap_t* heap);
 bool        _mi_heap_delayed_free_partial(mi_heap_t* heap);
@@ -212,6 +248,8 @@ void        _mi_heap_collect_retired(mi_heap_t* heap, bool force);
 void        _mi_page_use_delayed_free(mi_page_t* page, mi_delayed_t delay, bool override_never);
 bool        _mi_page_try_use_delayed_free(mi_page_t* page, mi_delayed_t delay, bool override_never);
 size_t      _mi_page_queue_append(mi_heap_t* heap, mi_page_queue_t* pq, mi_page_queue_t* append);
+void        _mi_page_queue_unlink(mi_page_t* page);
+mi_page_queue_t* _mi_page_queue_relink(mi_page_t* page);
 void        _mi_deferred_free(mi_heap_t* heap, bool force);
 
 void        _mi_page_free_collect(mi_page_t* page,bool force);
@@ -219,11 +257,14 @@ void        _mi_page_reclaim(mi_heap_t* heap, mi_page_t* page);   // callback fr
 
 size_t      _mi_bin_size(size_t bin);            // for stats
 size_t      _mi_bin(size_t size);                // for stats
+void        _mi_bins_init(void);                 // custom size classes
+void        _mi_heap_init_queues(mi_heap_t* heap);
 
 // "heap.c"
 void        _mi_heap_init(mi_heap_t* heap, mi_tld_t* tld, mi_arena_id_t arena_id, bool noreclaim, uint8_t tag);
 void        _mi_heap_destroy_pages(mi_heap_t* heap);
 void        _mi_heap_collect_abandon(mi_heap_t* heap);
+void        _mi_heap_set_owner(mi_heap_t* heap, mi_threadid_t tid);
 void        _mi_heap_set_default_direct(mi_heap_t* heap);
 bool        _mi_heap_memid_is_suitable(mi_heap_t* heap, mi_memid_t memid);
 void        _mi_heap_unsafe_destroy_all(mi_heap_t* heap);
@@ -248,6 +289,7 @@ mi_block_t* _mi_page_ptr_unalign(const mi_page_t* page, const void* p);
 bool        _mi_free_delayed_block(mi_block_t* block);
 void        _mi_free_generic(mi_segment_t* segment, mi_page_t* page, bool is_local, void* p) mi_attr_noexcept;  // for runtime integration
 void        _mi_padding_shrink(const mi_page_t* page, const mi_block_t* block, const size_t min_size);
+void        _mi_remote_free_flush(mi_tld_t* tld);
 
 #if MI_DEBUG>1
 bool        _mi_page_is_valid(mi_page_t* page);
@@ -652,6 +694,48 @@ static inline void mi_page_set_has_aligned(mi_page_t* page, bool has_aligned) {
   page->flags.x.has_aligned = has_aligned;
 }
 
+// The size of the page memory as accounted in its heap (see `mi_heap_set_limit`)
+static inline size_t mi_page_slices_size(const mi_page_t* page) {
+  return ((size_t)page->slice_count * MI_SEGMENT_SLICE_SIZE);
+}
+
+// Can the heap own `extra` more bytes of pages within its limit?
+static inline bool mi_heap_page_limit_allows(const mi_heap_t* heap, size_t extra) {
+  return (heap->page_bytes_limit == 0 || heap->page_bytes + extra <= heap->page_bytes_limit);
+}
+
+static inline bool mi_page_is_monotonic(const mi_page_t* page) {
+  return page->flags.x.is_monotonic;
+}
+
+static inline void mi_page_set_monotonic(mi_page_t* page, bool is_monotonic) {
+  page->flags.x.is_monotonic = is_monotonic;
+}
+
+static inline bool mi_page_has_sampled(const mi_page_t* page) {
+  return page->flags.x.has_sampled;
+}
+
+static inline void mi_page_set_has_sampled(mi_page_t* page, bool has_sampled) {
+  page->flags.x.has_sampled = has_sampled;
+}
+
+/* -------------------------------------------------------------------
+  Heap profiling
+------------------------------------------------------------------- */
+#if MI_PROFILE
+// Count down the allocated bytes and return `true` if this allocation should be sampled.
+// This code is on the hot path for allocation; when sampling is disabled the count starts at SIZE_MAX.
+static inline bool mi_heap_profile_sample(mi_heap_t* heap, size_t size) {
+  const size_t count = heap->profile_sample_count;
+  if mi_likely(size < count) {
+    heap->profile_sample_count = count - size;
+    return false;
+  }
+  return (heap->profile_sample_rate != 0);  // the count is 0 in the empty heap so we never write to it
+}
+#endif
+
 /* -------------------------------------------------------------------
   Guarded objects
 ------------------------------------------------------------------- */
@@ -30,6 +30,7 @@ typedef struct mi_os_mem_config_s {
   bool    has_overcommit;         // can we reserve more memory than can be actually committed?
   bool    has_partial_free;       // can allocated blocks be freed partially? (true for mmap, false for VirtualAlloc)
   bool    has_virtual_reserve;    // supports virtual address space reservation? (if true we can reserve virtual address space without using commit or physical memory)
+  bool    has_remap;              // can memory be resized or moved without copying? (e.g. using `mremap` on Linux)
 } mi_os_mem_config_t;
 
 // Initialize
@@ -63,15 +64,76 @@ int _mi_prim_decommit(void* addr, size_t size, bool* needs_recommit);
 // Returns error code or 0 on success.
 int _mi_prim_reset(void* addr, size_t size);
 
+// Decommit (if `decommit` is true) or reset many page aligned ranges at once.
+// Returns error code or 0 on success. The `needs_recommit` result is as in `_mi_prim_decommit`.
+// pre: needs_recommit != NULL
+int _mi_prim_purge_ranges(mi_os_range_t* ranges, size_t count, bool decommit, bool* needs_recommit);
+
+// Collapse a range into transparent huge pages (like `MADV_COLLAPSE`). The range should
+// be aligned to the huge page size. Returns error code or 0 on success.
+int _mi_prim_collapse(void* addr, size_t size);
+
+// Return the number of bytes of the process that are backed by transparent huge pages (or 0 if unknown).
+size_t _mi_prim_thp_size(void);
+
+// Populate (pre-fault) the physical pages of a committed range without changing its contents
+// (like `MADV_POPULATE_WRITE`). Returns error code or 0 on success (`ENOTSUP` if not supported).
+int _mi_prim_populate(void* addr, size_t size);
+
 // Protect memory. Returns error code or 0 on success.
 int _mi_prim_protect(void* addr, size_t size, bool protect);
 
+// Resize (and possibly move) committed memory to `newsize` bytes while preserving its contents
+// without copying (e.g. using `mremap` on Linux). The resulting `*newaddr` is aligned to `alignment`;
+// any extended part is zero initialized. Returns error code or 0 on success (in which case the
+// original range is no longer valid if it moved). Only called if `has_remap` is true.
+// pre: size, newsize, and alignment are multiples of the OS page size, and alignment is a power of 2.
+int _mi_prim_remap(void* addr, size_t size, size_t newsize, size_t alignment, void** newaddr);
+
+// Memory limit and pressure as seen by the process.
+typedef struct mi_memory_pressure_s {
+  size_t limit;   // memory limit in bytes (like the cgroup `memory.high` or `memory.max`), or 0 if unlimited
+  size_t stall;   // percentage of time (times 100) that tasks stalled on memory over the last 10 seconds (like PSI `some avg10`)
+} mi_memory_pressure_t;
+
+// Get the current memory limit and pressure. Returns `false` if not supported.
+bool _mi_prim_memory_pressure(mi_memory_pressure_t* mp);
+
+// Start a single background thread that calls `fun` repeatedly. The function returns the
+// number of milli-seconds to wait before it is called again, or a negative value to let the
+// thread exit (unless it was woken up in the mean time). Returns `false` if not supported.
+bool _mi_prim_bgthread_start(mi_msecs_t (*fun)(void));
+
+// Wake up the background thread so it calls its function again right away.
+// Returns `false` if the thread is not running (or has exited).
+bool _mi_prim_bgthread_wakeup(void);
+
+// Signal the background thread to stop and wait for it to finish.
+void _mi_prim_bgthread_stop(void);
+
+// Is the background thread running? (this is `false` in a forked child process, or when the thread has exited)
+bool _mi_prim_bgthread_is_running(void);
+
+// Call `fun(i,arg)` for each `0 <= i < nthreads` concurrently: the calling thread runs `fun(0,arg)` and
+// (up to 63) helper threads run the others. Waits until all are done. Helper threads that cannot be
+// started are skipped, so `fun` should share the work dynamically. Returns the number of threads used.
+size_t _mi_prim_run_parallel(size_t nthreads, void (*fun)(size_t i, void* arg), void* arg);
+
+// Capture the return addresses of the current call stack (innermost first) into `frames`, skipping
+// the innermost `skip` frames (besides this function itself). Returns the number of frames captured
+// (0 if not supported). Used by the sampling heap profiler (see `profile.c`).
+size_t _mi_prim_capture_stack(void** frames, size_t max_frames, size_t skip);
+
 // Allocate huge (1GiB) pages possibly associated with a NUMA node.
 // `is_zero` is set to true if the memory was zero initialized (as on most OS's)
 // pre: size > 0  and a multiple of 1GiB.
 //      numa_node is either negative (don't care), or a numa node number.
 int _mi_prim_alloc_huge_os_pages(void* hint_addr, size_t size, int numa_node, bool* is_zero, void** addr);
 
+// Set the preferred NUMA node for the physical pages of a memory range (like `mbind` with `MPOL_PREFERRED`).
+// Returns error code or 0 on success.
+int _mi_prim_numa_bind(void* addr, size_t size, int numa_node);
+
 // Return the current NUMA node
 size_t _mi_prim_numa_node(void);
 
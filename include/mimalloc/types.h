@@ -81,6 +81,9 @@ terms of the MIT license. A copy of the license can be found in the file
 #define MI_PADDING  0
 #endif
 
+// Sample allocations (every N bytes on average) with their stack trace for heap profiling (see `profile.c`)
+// #define MI_PROFILE 1
+
 // Reserve extra padding at the end of each block to be more resilient against heap block overflows.
 // The padding can detect buffer overflow on free.
 #if !defined(MI_PADDING) && (MI_SECURE>=3 || MI_DEBUG>=1 || (MI_TRACK_VALGRIND || MI_TRACK_ASAN || MI_TRACK_ETW))
@@ -264,14 +267,16 @@ typedef enum mi_delayed_e {
 } mi_delayed_t;
 
 
-// The `in_full` and `has_aligned` page flags are put in a union to efficiently
-// test if both are false (`full_aligned == 0`) in the `mi_free` routine.
+// The `in_full`, `has_aligned`, and `is_monotonic` page flags are put in a union to efficiently
+// test if all are false (`full_aligned == 0`) in the `mi_free` routine.
 #if !MI_TSAN
 typedef union mi_page_flags_s {
   uint8_t full_aligned;
   struct {
     uint8_t in_full : 1;
     uint8_t has_aligned : 1;
+    uint8_t is_monotonic : 1;
+    uint8_t has_sampled : 1;    // contains blocks sampled by the heap profiler (see `profile.c`)
   } x;
 } mi_page_flags_t;
 #else
@@ -281,6 +286,8 @@ typedef union mi_page_flags_s {
   struct {
     uint8_t in_full;
     uint8_t has_aligned;
+    uint8_t is_monotonic;
+    uint8_t has_sampled;
   } x;
 } mi_page_flags_t;
 #endif
@@ -328,7 +335,7 @@ typedef struct mi_page_s {
   // layout like this to optimize access in `mi_malloc` and `mi_free`
   uint16_t              capacity;          // number of blocks committed, must be the first field, see `segment.c:page_clear`
   uint16_t              reserved;          // number of blocks reserved in memory
-  mi_page_flags_t       flags;             // `in_full` and `has_aligned` flags (8 bits)
+  mi_page_flags_t       flags;             // `in_full`, `has_aligned`, and `is_monotonic` flags (8 bits)
   uint8_t               free_is_zero:1;    // `true` if the blocks in the free list are zero initialized
   uint8_t               retire_expire:7;   // expiration count for retired blocks
 
@@ -416,11 +423,12 @@ typedef enum mi_memkind_e {
   MI_MEM_OS,        // allocated from the OS
   MI_MEM_OS_HUGE,   // allocated as huge OS pages (usually 1GiB, pinned to physical memory)
   MI_MEM_OS_REMAP,  // allocated in a remapable area (i.e. using `mremap`)
+  MI_MEM_OS_REGION, // allocated in the reserved OS region (see `mi_option_os_region_reserve`)
   MI_MEM_ARENA      // allocated from an arena (the usual case)
 } mi_memkind_t;
 
 static inline bool mi_memkind_is_os(mi_memkind_t memkind) {
-  return (memkind >= MI_MEM_OS && memkind <= MI_MEM_OS_REMAP);
+  return (memkind >= MI_MEM_OS && memkind <= MI_MEM_OS_REGION);
 }
 
 typedef struct mi_memid_os_info {
@@ -445,6 +453,12 @@ typedef struct mi_memid_s {
   mi_memkind_t  memkind;
 } mi_memid_t;
 
+// A range of OS memory (used to purge many ranges at once)
+typedef struct mi_os_range_s {
+  void*   start;
+  size_t  size;
+} mi_os_range_t;
+
 
 // -----------------------------------------------------------------------------------------
 // Segments are large allocated memory blocks (32mb on 64 bit) from arenas or the OS.
@@ -469,11 +483,14 @@ typedef struct mi_segment_s {
   bool              allow_purge;        // can we purge the memory (reset or decommit)
   size_t            segment_size;
   mi_subproc_t*     subproc;            // segment belongs to sub process
+  int               numa_node;          // numa node of the segment memory (or -1 if unknown)
+  bool              numa_remote;        // was the segment allocated for a thread (or heap) on another numa node?
 
   // segment fields
   mi_msecs_t        purge_expire;       // purge slices in the `purge_mask` after this time
   mi_commit_mask_t  purge_mask;         // slices that can be purged
   mi_commit_mask_t  commit_mask;        // slices that are currently committed
+  mi_msecs_t        thp_collapse;       // try to collapse into transparent huge pages after this time (0 if done or disabled)
 
   // from here is zero initialized
   struct mi_segment_s* next;            // the list of freed segments in the cache (must be first field, see `segment.c:mi_segment_init`)
@@ -557,15 +574,21 @@ struct mi_heap_s {
   mi_threadid_t         thread_id;                           // thread this heap belongs too
   mi_arena_id_t         arena_id;                            // arena id if the heap belongs to a specific arena (or 0)
   uintptr_t             cookie;                              // random cookie to verify pointers (see `_mi_ptr_cookie`)
+  int                   numa_node;                           // preferred numa node of the heap (or -1 for the node of the current thread)
   uintptr_t             keys[2];                             // two random keys used to encode the `thread_delayed_free` list
   mi_random_ctx_t       random;                              // random number context used for secure allocation
   size_t                page_count;                          // total number of pages in the `pages` queues.
+  size_t                page_bytes;                          // total size of the pages in the `pages` queues.
+  size_t                page_bytes_limit;                    // maximal `page_bytes` (or 0 if unlimited) (see `mi_heap_set_limit`)
+  mi_heap_limit_fun*    limit_fun;                           // called when an allocation would exceed the limit
+  void*                 limit_arg;                           // argument for `limit_fun`
   size_t                page_retired_min;                    // smallest retired index (retired pages are fully free, but still in the page queues)
   size_t                page_retired_max;                    // largest retired index into the `pages` array.
   long                  generic_count;                       // how often is `_mi_malloc_generic` called?
   long                  generic_collect_count;               // how often is `_mi_malloc_generic` called without collecting?
   mi_heap_t*            next;                                // list of heaps per thread
   bool                  no_reclaim;                          // `true` if this heap should not reclaim abandoned pages
+  bool                  monotonic;                           // `true` if this heap bump allocates and ignores frees (see `mi_heap_new_monotonic`)
   uint8_t               tag;                                 // custom tag, can be used for separating heaps based on the object types
   #if MI_GUARDED
   size_t                guarded_size_min;                    // minimal size for guarded objects
@@ -574,6 +597,10 @@ struct mi_heap_s {
   size_t                guarded_sample_seed;                 // starting sample count
   size_t                guarded_sample_count;                // current sample count (counting down to 0)
   #endif
+  #if MI_PROFILE
+  size_t                profile_sample_rate;                 // average bytes between profile samples (0 to disable profiling)
+  size_t                profile_sample_count;                // bytes until the next profile sample (counting down)
+  #endif
   mi_page_t*            pages_free_direct[MI_PAGES_DIRECT];  // optimize: array where every entry points a page with possibly free blocks in the corresponding queue for that size.
   mi_page_queue_t       pages[MI_BIN_FULL + 1];              // queue of pages for each size class (or "bin")
 };
@@ -585,6 +612,20 @@ struct mi_heap_s {
 // static variables of a process.
 // ------------------------------------------------------
 
+// Abandoned segments in arenas are indexed by the size bins for which they have
+// pages with free blocks, and by whether they are mostly free. Each bucket is a small
+// ring of hints (the encoded arena and block index of the segment). The arena
+// `blocks_abandoned` bitmaps remain the ground truth so stale hints are harmless.
+#define MI_ABANDONED_HINTS          (8)                     // hints per bucket
+#define MI_ABANDONED_HINT_FREE      (MI_BIN_HUGE+1)         // bucket for segments that are mostly free
+#define MI_ABANDONED_HINT_BUCKETS   (MI_BIN_HUGE+2)
+#define MI_ABANDONED_HINT_MAX       (8)                     // max buckets a segment is indexed in
+
+typedef struct mi_abandoned_hints_s {
+  _Atomic(size_t)    next;                    // next slot to write
+  _Atomic(size_t)    hints[MI_ABANDONED_HINTS]; // encoded segment positions (0 if empty)
+} mi_abandoned_hints_t;
+
 struct mi_subproc_s {
   _Atomic(size_t)    abandoned_count;         // count of abandoned segments for this sub-process
   _Atomic(size_t)    abandoned_os_list_count; // count of abandoned segments in the os-list
@@ -592,6 +633,7 @@ struct mi_subproc_s {
   mi_lock_t          abandoned_os_visit_lock; // ensure only one thread per subproc visits the abandoned os list
   mi_segment_t*      abandoned_os_list;       // doubly-linked list of abandoned segments outside of arena's (in OS allocated memory)
   mi_segment_t*      abandoned_os_list_tail;  // the tail-end of the list
+  mi_abandoned_hints_t abandoned_index[MI_ABANDONED_HINT_BUCKETS]; // index of abandoned arena segments by bin (and mostly free ones)
   mi_memid_t         memid;                   // provenance of this memory block
 };
 
@@ -618,11 +660,23 @@ typedef struct mi_segments_tld_s {
   size_t              current_size; // current size of all segments
   size_t              peak_size;    // peak size of all segments
   size_t              reclaim_count;// number of reclaimed (abandoned) segments
+  size_t              reclaim_numa_misses; // consecutive reclaim attempts that found no suitable segment on the local numa node
   mi_subproc_t*       subproc;      // sub-process this thread belongs to.
   mi_stats_t*         stats;        // points to tld stats
 } mi_segments_tld_t;
 
 // Thread local data
+// Blocks freed by this thread into a page owned by another thread are buffered
+// per destination page (if `mi_option_remote_free_buffer` is enabled) and published at once.
+#define MI_REMOTE_FREE_SLOTS  (8)
+
+typedef struct mi_remote_free_s {
+  mi_page_t*          page;          // destination page (or NULL if the slot is unused)
+  mi_block_t*         first;         // chain of buffered blocks (linked using the page keys)
+  mi_block_t*         last;
+  size_t              count;         // number of blocks in the chain
+} mi_remote_free_t;
+
 struct mi_tld_s {
   unsigned long long  heartbeat;     // monotonic heartbeat count
   bool                recurse;       // true if deferred was called; used to prevent infinite recursion.
@@ -630,6 +684,7 @@ struct mi_tld_s {
   mi_heap_t*          heaps;         // list of heaps in this thread (so we can abandon all when the thread terminates)
   mi_segments_tld_t   segments;      // segment tld
   mi_stats_t          stats;         // statistics
+  mi_remote_free_t    remote_free[MI_REMOTE_FREE_SLOTS]; // buffered frees into pages of other threads
 };
 
 
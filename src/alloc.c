@@ -25,6 +25,29 @@ terms of the MIT license. A copy of the license can be found in the file
 // Allocation
 // ------------------------------------------------------
 
+// Set the padding (canary and delta) after a block of `size` bytes (including the padding)
+static inline void mi_page_block_set_padding(const mi_page_t* page, mi_block_t* block, size_t size) {
+  #if MI_PADDING // && !MI_TRACK_ENABLED
+  mi_padding_t* const padding = (mi_padding_t*)((uint8_t*)block + mi_page_usable_block_size(page));
+  ptrdiff_t delta = ((uint8_t*)padding - (uint8_t*)block - (size - MI_PADDING_SIZE));
+  #if (MI_DEBUG>=2)
+  mi_assert_internal(delta >= 0 && mi_page_usable_block_size(page) >= (size - MI_PADDING_SIZE + delta));
+  #endif
+  mi_track_mem_defined(padding,sizeof(mi_padding_t));  // note: re-enable since mi_page_usable_block_size may set noaccess
+  padding->canary = mi_ptr_encode_canary(page,block,page->keys);
+  padding->delta  = (uint32_t)(delta);
+  #if MI_PADDING_CHECK
+  if (!mi_page_is_huge(page)) {
+    uint8_t* fill = (uint8_t*)padding - delta;
+    const size_t maxpad = (delta > MI_MAX_ALIGN_SIZE ? MI_MAX_ALIGN_SIZE : delta); // set at most N initial padding bytes
+    for (size_t i = 0; i < maxpad; i++) { fill[i] = MI_DEBUG_PADDING; }
+  }
+  #endif
+  #else
+  MI_UNUSED(page); MI_UNUSED(block); MI_UNUSED(size);
+  #endif
+}
+
 // Fast allocation in a page: just pop from the free list.
 // Fall back to generic allocation only if the list is empty.
 // Note: in release mode the (inlined) routine is about 7 instructions with a single test.
@@ -94,24 +117,7 @@ extern inline void* _mi_page_malloc_zero(mi_heap_t* heap, mi_page_t* page, size_
   }
   #endif
 
-  #if MI_PADDING // && !MI_TRACK_ENABLED
-    mi_padding_t* const padding = (mi_padding_t*)((uint8_t*)block + mi_page_usable_block_size(page));
-    ptrdiff_t delta = ((uint8_t*)padding - (uint8_t*)block - (size - MI_PADDING_SIZE));
-    #if (MI_DEBUG>=2)
-    mi_assert_internal(delta >= 0 && mi_page_usable_block_size(page) >= (size - MI_PADDING_SIZE + delta));
-    #endif
-    mi_track_mem_defined(padding,sizeof(mi_padding_t));  // note: re-enable since mi_page_usable_block_size may set noaccess
-    padding->canary = mi_ptr_encode_canary(page,block,page->keys);
-    padding->delta  = (uint32_t)(delta);
-    #if MI_PADDING_CHECK
-    if (!mi_page_is_huge(page)) {
-      uint8_t* fill = (uint8_t*)padding - delta;
-      const size_t maxpad = (delta > MI_MAX_ALIGN_SIZE ? MI_MAX_ALIGN_SIZE : delta); // set at most N initial padding bytes
-      for (size_t i = 0; i < maxpad; i++) { fill[i] = MI_DEBUG_PADDING; }
-    }
-    #endif
-  #endif
-
+  mi_page_block_set_padding(page, block, size);
   return block;
 }
 
@@ -147,6 +153,9 @@ static inline mi_decl_restrict void* mi_heap_malloc_small_zero(mi_heap_t* heap,
   mi_page_t* page = _mi_heap_get_free_small_page(heap, size + MI_PADDING_SIZE);
   void* const p = _mi_page_malloc_zero(heap, page, size + MI_PADDING_SIZE, zero);
   mi_track_malloc(p,size,zero);
+  #if MI_PROFILE
+  if mi_unlikely(mi_heap_profile_sample(heap, size)) { _mi_heap_profile_sample(heap, p, size); }
+  #endif
 
   #if MI_DEBUG>3
   if (p != NULL && zero) {
@@ -183,6 +192,9 @@ extern inline void* _mi_heap_malloc_zero_ex(mi_heap_t* heap, size_t size, bool z
     mi_assert(heap->thread_id == 0 || heap->thread_id == _mi_thread_id());   // heaps are thread local
     void* const p = _mi_malloc_generic(heap, size + MI_PADDING_SIZE, zero, huge_alignment);  // note: size can overflow but it is detected in malloc_generic
     mi_track_malloc(p,size,zero);
+    #if MI_PROFILE
+    if mi_unlikely(mi_heap_profile_sample(heap, size)) { _mi_heap_profile_sample(heap, p, size); }
+    #endif
 
     #if MI_DEBUG>3
     if (p != NULL && zero) {
@@ -240,6 +252,166 @@ mi_decl_nodiscard mi_decl_restrict void* mi_mallocn(size_t count, size_t size) m
   return mi_heap_mallocn(mi_prim_get_default_heap(),count,size);
 }
 
+
+// ------------------------------------------------------
+// Batch allocation
+// ------------------------------------------------------
+
+// Pop a run of at most `count` blocks from the free list of `page` into `out`.
+// `size` includes the padding. Returns the number of blocks popped.
+static size_t mi_page_malloc_run(mi_heap_t* heap, mi_page_t* page, size_t size, bool zero, void** out, size_t count) mi_attr_noexcept {
+  size_t n = 0;
+  #if MI_PADDING || (MI_DEBUG>0) || MI_TRACK_ENABLED
+  // initialize each block through the regular path to set the padding, debug fill, and tracking
+  while (n < count && page->free != NULL) {
+    void* const p = _mi_page_malloc_zero(heap, page, size, zero);
+    mi_track_malloc(p, size - MI_PADDING_SIZE, zero);
+    out[n++] = p;
+  }
+  #else
+  const size_t bsize = mi_page_block_size(page);
+  mi_block_t* block = page->free;
+  while (n < count && block != NULL) {
+    mi_block_t* const next = mi_block_next(page, block);
+    if mi_unlikely(zero) {
+      if (page->free_is_zero) { block->next = 0; }
+                         else { _mi_memzero_aligned(block, bsize); }
+    }
+    #if (MI_SECURE!=0)
+    else { block->next = 0; } // don't leak internal data
+    #endif
+    out[n++] = block;
+    block = next;
+  }
+  page->free = block;
+  page->used += (uint16_t)n;
+  mi_assert_internal(page->used <= page->capacity);
+
+  // update the statistics once for the whole run
+  #if (MI_STAT>0)
+  if (n > 0 && bsize <= MI_MEDIUM_OBJ_SIZE_MAX) {
+    mi_heap_stat_increase(heap, malloc_normal, n * bsize);
+    mi_heap_stat_counter_increase(heap, malloc_normal_count, n);
+    #if (MI_STAT>1)
+    mi_heap_stat_increase(heap, malloc_bins[_mi_bin(bsize)], n);
+    mi_heap_stat_increase(heap, malloc_requested, n * size);
+    #endif
+  }
+  #else
+  MI_UNUSED(heap); MI_UNUSED(size);
+  #endif
+  #endif
+  return n;
+}
+
+// Allocate `count` blocks of `size` bytes into `out`. After the first block is allocated from
+// a page, the rest of the free list of that page is drained in one run; only when a page is
+// exhausted do we go through the regular allocation path again (to find or allocate a fresh page).
+// Returns the number of blocks allocated, which is less than `count` only when out of memory.
+static size_t mi_heap_malloc_batch_zero(mi_heap_t* heap, size_t size, size_t count, void** out, bool zero) mi_attr_noexcept {
+  mi_assert(heap != NULL);
+  mi_assert(heap->thread_id == 0 || heap->thread_id == _mi_thread_id());   // heaps are thread local
+  if (out == NULL || count == 0) return 0;
+  #if (MI_PADDING || MI_GUARDED)
+  if (size == 0) { size = sizeof(void*); }
+  #endif
+  // only small and medium blocks are drained; larger pages contain just a few blocks
+  const bool drain = (size <= MI_MEDIUM_OBJ_SIZE_MAX);
+  const size_t bsize = (drain ? _mi_bin_size(_mi_bin(size + MI_PADDING_SIZE)) : 0);
+  size_t n = 0;
+  while (n < count) {
+    void* const p = _mi_heap_malloc_zero(heap, size, zero);
+    if mi_unlikely(p == NULL) break;
+    out[n++] = p;
+    if (drain && n < count) {
+      mi_page_t* const page = _mi_ptr_page(p);
+      if (mi_page_block_size(page) == bsize) {  // not a guarded block in a page of another size class
+        if (page->free == NULL) { _mi_page_free_collect(page, false); }
+        const size_t m = mi_page_malloc_run(heap, page, size + MI_PADDING_SIZE, zero, out + n, count - n);
+        #if MI_PROFILE
+        for (size_t i = n; i < n + m; i++) {
+          if mi_unlikely(mi_heap_profile_sample(heap, size)) { _mi_heap_profile_sample(heap, out[i], size); }
+        }
+        #endif
+        n += m;
+      }
+    }
+  }
+  return n;
+}
+
+mi_decl_nodiscard size_t mi_heap_malloc_batch(mi_heap_t* heap, size_t size, size_t count, void** out) mi_attr_noexcept {
+  return mi_heap_malloc_batch_zero(heap, size, count, out, false);
+}
+
+mi_decl_nodiscard size_t mi_heap_zalloc_batch(mi_heap_t* heap, size_t size, size_t count, void** out) mi_attr_noexcept {
+  return mi_heap_malloc_batch_zero(heap, size, count, out, true);
+}
+
+mi_decl_nodiscard size_t mi_malloc_batch(size_t size, size_t count, void** out) mi_attr_noexcept {
+  return mi_heap_malloc_batch(mi_prim_get_default_heap(), size, count, out);
+}
+
+mi_decl_nodiscard size_t mi_zalloc_batch(size_t size, size_t count, void** out) mi_attr_noexcept {
+  return mi_heap_zalloc_batch(mi_prim_get_default_heap(), size, count, out);
+}
+
+// Try to grow a large block in place to `newsize` by extending its page into the
+// free slices that directly follow it in the segment (only for pages with a single block).
+static bool mi_try_grow_in_place(void* p, size_t newsize) {
+  #if MI_TRACK_ENABLED
+  MI_UNUSED(p); MI_UNUSED(newsize);
+  return false;
+  #else
+  mi_assert_internal(p != NULL);
+  if (newsize > MI_LARGE_OBJ_SIZE_MAX) return false;
+  const mi_segment_t* const segment = _mi_ptr_segment(p);
+  if (segment->thread_id != _mi_prim_thread_id()) return false;   // only for our own pages
+  mi_page_t* const page = _mi_segment_page_of(segment, p);
+  const size_t old_bsize = mi_page_usable_block_size(page);
+  if (old_bsize <= MI_MEDIUM_OBJ_SIZE_MAX || page->reserved != 1 || mi_page_has_aligned(page) || p != mi_page_start(page)) return false;
+  mi_heap_t* const heap = mi_page_heap(page);
+  if (!mi_heap_page_limit_allows(heap, (newsize > old_bsize ? newsize - old_bsize : 0))) return false;
+  const size_t old_size = mi_page_slices_size(page);
+  if (!_mi_segment_page_try_grow(page, newsize + MI_PADDING_SIZE, &heap->tld->segments)) return false;
+  heap->page_bytes += mi_page_slices_size(page) - old_size;
+  mi_heap_stat_increase(heap, malloc_huge, mi_page_usable_block_size(page) - old_bsize);
+  mi_page_block_set_padding(page, (mi_block_t*)p, newsize + MI_PADDING_SIZE);
+  return true;
+  #endif
+}
+
+// Try to resize a huge block in remappable memory to `newsize` by remapping its pages.
+// This avoids copying but the block may move. Returns the (new) block or NULL on failure.
+static void* mi_try_remap_huge(void* p, size_t newsize) {
+  #if MI_TRACK_ENABLED
+  MI_UNUSED(p); MI_UNUSED(newsize);
+  return NULL;
+  #else
+  mi_assert_internal(p != NULL);
+  const mi_segment_t* const segment = _mi_ptr_segment(p);
+  if (segment->kind != MI_SEGMENT_HUGE || segment->memid.memkind != MI_MEM_OS_REMAP) return NULL;
+  if (segment->thread_id != _mi_prim_thread_id()) return NULL;   // only for our own pages
+  if (newsize > MI_MAX_ALLOC_SIZE - MI_PADDING_SIZE) return NULL;
+  mi_page_t* page = _mi_segment_page_of(segment, p);
+  if (mi_page_has_aligned(page) || p != mi_page_start(page)) return NULL;
+  #if (MI_STAT>0)
+  mi_heap_t* const heap = mi_page_heap(page);
+  const size_t old_bsize = mi_page_usable_block_size(page);
+  #endif
+  page = _mi_page_huge_remap(page, _mi_os_good_alloc_size(newsize + MI_PADDING_SIZE));
+  if (page == NULL) return NULL;
+  #if (MI_STAT>0)
+  const size_t bsize = mi_page_usable_block_size(page);
+  if (bsize > old_bsize) { mi_heap_stat_increase(heap, malloc_huge, bsize - old_bsize); }
+                    else { mi_heap_stat_decrease(heap, malloc_huge, old_bsize - bsize); }
+  #endif
+  mi_block_t* const block = (mi_block_t*)mi_page_start(page);
+  mi_page_block_set_padding(page, block, newsize + MI_PADDING_SIZE);
+  return block;
+  #endif
+}
+
 // Expand (or shrink) in place (or fail)
 void* mi_expand(void* p, size_t newsize) mi_attr_noexcept {
   #if MI_PADDING
@@ -249,7 +421,7 @@ void* mi_expand(void* p, size_t newsize) mi_attr_noexcept {
   #else
   if (p == NULL) return NULL;
   const size_t size = _mi_usable_size(p,"mi_expand");
-  if (newsize > size) return NULL;
+  if (newsize > size && !mi_try_grow_in_place(p, newsize)) return NULL;
   return p; // it fits
   #endif
 }
@@ -266,6 +438,25 @@ void* _mi_heap_realloc_zero(mi_heap_t* heap, void* p, size_t newsize, bool zero)
     // if (newsize < size) { mi_track_mem_noaccess((uint8_t*)p + newsize, size - newsize); }
     return p;  // reallocation still fits and not more than 50% waste
   }
+  // try to resize large and huge blocks without copying
+  void* resized = NULL;
+  if (p != NULL && newsize > size && mi_try_grow_in_place(p, newsize)) {
+    resized = p;  // grown in place into the following free slices
+  }
+  else if (p != NULL && newsize > MI_LARGE_OBJ_SIZE_MAX) {
+    resized = mi_try_remap_huge(p, newsize);
+  }
+  if (resized != NULL) {
+    #if MI_PROFILE
+    if mi_unlikely(mi_page_has_sampled(_mi_ptr_page(resized))) { _mi_profile_resize(p, resized, newsize); }
+    #endif
+    if (zero && newsize > size) {
+      // also set last word in the previous allocation to zero to ensure any padding is zero-initialized
+      const size_t start = (size >= sizeof(intptr_t) ? size - sizeof(intptr_t) : 0);
+      _mi_memzero((uint8_t*)resized + start, newsize - start);
+    }
+    return resized;
+  }
   void* newp = mi_heap_malloc(heap,newsize);
   if mi_likely(newp != NULL) {
     if (zero && newsize > size) {
@@ -40,6 +40,11 @@ bool        mi_arena_memid_indices(mi_memid_t memid, size_t* arena_index, mi_bit
   Reclaim and visiting either scan through the `block_abandoned`
   bitmaps of the arena's, or visit the `abandoned_os_list`
 
+  To avoid long scans when there are many abandoned segments, segments
+  in arenas are also indexed in the sub-process `abandoned_index` by
+  the size bins that have free blocks (and whether they are mostly free)
+  so reclaim can first try a segment that likely satisfies the request.
+
   A potentially nicer design is to use arena's for everything
   and perhaps have virtual arena's to map OS allocated memory
   but this would lack the "density" of our current arena's. TBC.
@@ -138,9 +143,31 @@ static void mi_arena_segment_os_mark_abandoned(mi_segment_t* segment) {
   return;
 }
 
-// mark a specific segment as abandoned
+// encode a segment position in an arena as an abandoned index hint (never 0)
+static size_t mi_abandoned_hint_encode(size_t arena_idx, size_t bitmap_idx) {
+  return (bitmap_idx * MI_MAX_ARENAS) + arena_idx + 1;
+}
+
+static void mi_abandoned_hint_decode(size_t hint, size_t* arena_idx, size_t* bitmap_idx) {
+  mi_assert_internal(hint > 0);
+  *arena_idx  = (hint - 1) % MI_MAX_ARENAS;
+  *bitmap_idx = (hint - 1) / MI_MAX_ARENAS;
+}
+
+static void mi_abandoned_hint_push(mi_subproc_t* subproc, size_t bucket, size_t hint) {
+  mi_assert_internal(bucket < MI_ABANDONED_HINT_BUCKETS);
+  mi_abandoned_hints_t* const hints = &subproc->abandoned_index[bucket];
+  const size_t i = mi_atomic_increment_relaxed(&hints->next) % MI_ABANDONED_HINTS;
+  mi_atomic_store_release(&hints->hints[i], hint);  // overwrites the oldest hint
+}
+
+void _mi_arena_segment_mark_abandoned(mi_segment_t* segment) {
+  _mi_arena_segment_mark_abandoned_indexed(segment, NULL, 0);
+}
+
+// mark a specific segment as abandoned and add it to the abandoned index `buckets`
 // clears the thread_id.
-void _mi_arena_segment_mark_abandoned(mi_segment_t* segment)
+void _mi_arena_segment_mark_abandoned_indexed(mi_segment_t* segment, const uint8_t* buckets, size_t bucket_count)
 {
   mi_assert_internal(segment->used == segment->abandoned);
   mi_atomic_store_release(&segment->thread_id, (uintptr_t)0);  // mark as abandoned for multi-thread free's
@@ -160,6 +187,11 @@ void _mi_arena_segment_mark_abandoned(mi_segment_t* segment)
   if (was_unmarked) { mi_atomic_increment_relaxed(&subproc->abandoned_count); }
   mi_assert_internal(was_unmarked);
   mi_assert_internal(_mi_bitmap_is_claimed(arena->blocks_inuse, arena->field_count, 1, bitmap_idx));
+  // and index it
+  const size_t hint = mi_abandoned_hint_encode(arena_idx, bitmap_idx);
+  for (size_t i = 0; i < bucket_count; i++) {
+    mi_abandoned_hint_push(subproc, buckets[i], hint);
+  }
 }
 
 
@@ -175,6 +207,10 @@ void _mi_arena_field_cursor_init(mi_heap_t* heap, mi_subproc_t* subproc, bool vi
   current->subproc = subproc;
   current->visit_all = visit_all;
   current->hold_visit_lock = false;
+  current->numa_node = -1;
+  current->numa_pass = 0;
+  current->numa_remote = true;
+  current->numa_start = 0;
   const size_t abandoned_count = mi_atomic_load_relaxed(&subproc->abandoned_count);
   const size_t abandoned_list_count = mi_atomic_load_relaxed(&subproc->abandoned_os_list_count);
   const size_t max_arena = mi_arena_get_count();
@@ -199,6 +235,23 @@ void _mi_arena_field_cursor_init(mi_heap_t* heap, mi_subproc_t* subproc, bool vi
   mi_assert_internal(current->start <= max_arena);
 }
 
+// Visit the arenas on `numa_node` first, and only then (if `visit_remote` is set) the arenas on other nodes.
+// Arenas without a specific node count as local. This has no effect with a single numa node.
+void _mi_arena_field_cursor_prefer_numa(mi_arena_field_cursor_t* current, int numa_node, bool visit_remote) {
+  if (numa_node < 0 || current->visit_all || current->start >= current->end || _mi_os_numa_node_count() <= 1) return;
+  current->numa_node = numa_node;
+  current->numa_pass = 1;
+  current->numa_remote = visit_remote;
+  current->numa_start = current->start;
+}
+
+static bool mi_arena_field_cursor_skip(const mi_arena_field_cursor_t* current, mi_arena_t* arena) {
+  if (current->numa_pass == 0) return false;
+  const int  numa_node = mi_arena_numa_node(arena);
+  const bool is_remote = (numa_node >= 0 && numa_node != current->numa_node);
+  return (current->numa_pass == 1 ? is_remote : !is_remote);
+}
+
 void _mi_arena_field_cursor_done(mi_arena_field_cursor_t* current) {
   if (current->hold_visit_lock) {
     mi_lock_release(&current->subproc->abandoned_os_visit_lock);
@@ -229,6 +282,34 @@ static mi_segment_t* mi_arena_segment_clear_abandoned_at(mi_arena_t* arena, mi_s
   }
 }
 
+// Reclaim an abandoned segment from the abandoned index `bucket` (newest hints first).
+// Hints are consumed even if the segment was already reclaimed by another thread.
+// This does not set the thread id (so it appears as still abandoned).
+mi_segment_t* _mi_arena_segment_clear_abandoned_indexed(mi_subproc_t* subproc, size_t bucket) {
+  mi_assert_internal(bucket < MI_ABANDONED_HINT_BUCKETS);
+  mi_abandoned_hints_t* const hints = &subproc->abandoned_index[bucket];
+  const size_t next = mi_atomic_load_relaxed(&hints->next);
+  for (size_t n = MI_ABANDONED_HINTS; n > 0; n--) {
+    _Atomic(size_t)* const slot = &hints->hints[(next + n - 1) % MI_ABANDONED_HINTS];
+    if (mi_atomic_load_relaxed(slot) == 0) continue;
+    const size_t hint = mi_atomic_exchange_acq_rel(slot, (size_t)0);
+    if (hint == 0) continue;
+    size_t arena_idx;
+    size_t bitmap_idx;
+    mi_abandoned_hint_decode(hint, &arena_idx, &bitmap_idx);
+    mi_arena_t* const arena = mi_arena_from_index(arena_idx);
+    if (arena == NULL || mi_bitmap_index_field(bitmap_idx) >= arena->field_count) continue;
+    if (!_mi_bitmap_is_claimed(arena->blocks_abandoned, arena->field_count, 1, bitmap_idx)) continue;  // stale
+    // take the visit lock if abandoned visiting is enabled (see `mi_arena_segment_clear_abandoned_at`)
+    const bool use_lock = mi_option_is_enabled(mi_option_visit_abandoned);
+    if (use_lock && !mi_lock_try_acquire(&arena->abandoned_visit_lock)) continue;
+    mi_segment_t* const segment = mi_arena_segment_clear_abandoned_at(arena, subproc, bitmap_idx);
+    if (use_lock) { mi_lock_release(&arena->abandoned_visit_lock); }
+    if (segment != NULL) return segment;
+  }
+  return NULL;
+}
+
 static mi_segment_t* mi_arena_segment_clear_abandoned_next_field(mi_arena_field_cursor_t* previous) {
   const size_t max_arena = mi_arena_get_count();
   size_t field_idx = mi_bitmap_index_field(previous->bitmap_idx);
@@ -238,7 +319,7 @@ static mi_segment_t* mi_arena_segment_clear_abandoned_next_field(mi_arena_field_
     // index wraps around
     size_t arena_idx = (previous->start >= max_arena ? previous->start % max_arena : previous->start);
     mi_arena_t* arena = mi_arena_from_index(arena_idx);
-    if (arena != NULL) {
+    if (arena != NULL && !mi_arena_field_cursor_skip(previous, arena)) {
       bool has_lock = false;
       // visit the abandoned fields (starting at previous_idx)
       for (; field_idx < arena->field_count; field_idx++, bit_idx = 0) {
@@ -319,6 +400,14 @@ mi_segment_t* _mi_arena_segment_clear_abandoned_next(mi_arena_field_cursor_t* pr
     // walk the arena
     mi_segment_t* segment = mi_arena_segment_clear_abandoned_next_field(previous);
     if (segment != NULL) { return segment; }
+    if (previous->numa_pass == 1 && previous->numa_remote) {
+      // no more entries on the local numa node, walk the arena's on other nodes
+      previous->numa_pass = 2;
+      previous->start = previous->numa_start;
+      previous->bitmap_idx = 0;
+      segment = mi_arena_segment_clear_abandoned_next_field(previous);
+      if (segment != NULL) { return segment; }
+    }
   }
   // no entries in the arena's anymore, walk the abandoned OS list
   mi_assert_internal(previous->start == previous->end);
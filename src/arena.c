@@ -22,6 +22,7 @@ The arena allocation needs to be thread safe and we use an atomic bitmap to allo
 #include "mimalloc.h"
 #include "mimalloc/internal.h"
 #include "mimalloc/atomic.h"
+#include "mimalloc/prim.h"   // background thread
 #include "bitmap.h"
 
 
@@ -38,30 +39,85 @@ typedef struct mi_arena_s {
   size_t              field_count;          // number of bitmap fields (where `field_count * MI_BITMAP_FIELD_BITS >= block_count`)
   size_t              meta_size;            // size of the arena structure itself (including its bitmaps)
   mi_memid_t          meta_memid;           // memid of the arena structure itself (OS or static allocation)
-  int                 numa_node;            // associated NUMA node
+  _Atomic(intptr_t)   numa_node;            // associated NUMA node (can change when a released arena is reused)
   bool                exclusive;            // only allow allocations if specifically for this arena
   bool                is_large;             // memory area consists of large- or huge OS pages (always committed)
   mi_lock_t           abandoned_visit_lock; // lock is only used when abandoned segments are being visited
   _Atomic(size_t)     search_idx;           // optimization to start the search for free blocks
   _Atomic(mi_msecs_t) purge_expire;         // expiration time when blocks should be purged from `blocks_purge`.
+  bool                is_releasable;        // reserved on demand from the OS so it can be released when idle (see `mi_option_arena_release_delay`)
+  _Atomic(size_t)     release_state;        // MI_ARENA_LIVE, MI_ARENA_RELEASED (memory is unmapped), or MI_ARENA_REUSING (being re-initialized)
+  _Atomic(mi_msecs_t) idle_since;           // time since the arena is seen to be completely free (or 0)
+  _Atomic(size_t)     prefault_claims;      // number of free blocks temporarily claimed by `mi_arena_prefault`
   
   mi_bitmap_field_t*  blocks_dirty;         // are the blocks potentially non-zero?
   mi_bitmap_field_t*  blocks_committed;     // are the blocks committed? (can be NULL for memory that cannot be decommitted)
   mi_bitmap_field_t*  blocks_purge;         // blocks that can be (reset) decommitted. (can be NULL for memory that cannot be (reset) decommitted)
   mi_bitmap_field_t*  blocks_abandoned;     // blocks that start with an abandoned segment. (This crosses API's but it is convenient to have here)
+  mi_bitmap_field_t*  blocks_inuse_summary; // summary of the in-use bitmap: one bit per field that may have free blocks
   mi_bitmap_field_t   blocks_inuse[1];      // in-place bitmap of in-use blocks (of size `field_count`)
-  // do not add further fields here as the dirty, committed, purged, and abandoned bitmaps follow the inuse bitmap fields.
+  // do not add further fields here as the dirty, committed, purged, abandoned, and summary bitmaps follow the inuse bitmap fields.
 } mi_arena_t;
 
 
 #define MI_ARENA_BLOCK_SIZE   (MI_SEGMENT_SIZE)        // 64MiB  (must be at least MI_SEGMENT_ALIGN)
 #define MI_ARENA_MIN_OBJ_SIZE (MI_ARENA_BLOCK_SIZE/2)  // 32MiB
-#define MI_MAX_ARENAS         (132)                    // Limited as the reservation exponentially increases (and takes up .bss)
-
-// The available arenas
-static mi_decl_cache_align _Atomic(mi_arena_t*) mi_arenas[MI_MAX_ARENAS];
+#define MI_ARENA_CHUNK_SIZE   (128)                    // arenas per chunk of the arena table
+#define MI_ARENA_CHUNKS       (64)
+#define MI_MAX_ARENAS         (MI_ARENA_CHUNKS * MI_ARENA_CHUNK_SIZE)  // 8192
+
+#define MI_ARENA_LIVE         (0)
+#define MI_ARENA_RELEASED     (1)
+#define MI_ARENA_REUSING      (2)
+
+// The arena table grows in chunks; the first chunk is static (to keep the .bss small) and
+// further chunks are allocated on demand. Chunks and arena descriptors are never freed
+// (as other threads may access them concurrently) but the memory of idle arenas can be released.
+typedef struct mi_arena_chunk_s {
+  _Atomic(mi_arena_t*) arenas[MI_ARENA_CHUNK_SIZE];
+  mi_memid_t           memid;
+} mi_arena_chunk_t;
+
+static mi_decl_cache_align _Atomic(mi_arena_t*)       mi_arenas[MI_ARENA_CHUNK_SIZE];
+static mi_decl_cache_align _Atomic(mi_arena_chunk_t*) mi_arena_chunks[MI_ARENA_CHUNKS];  // (the first entry is unused)
 static mi_decl_cache_align _Atomic(size_t)      mi_arena_count; // = 0
 static mi_decl_cache_align _Atomic(int64_t)     mi_arenas_purge_expire; // set if there exist purgeable arenas
+static mi_decl_cache_align _Atomic(int64_t)     mi_arenas_release_expire; // set if there may be idle arenas to release
+
+// Get the slot in the arena table for an arena index (or NULL if out of range or not yet allocated and `create` is false)
+static _Atomic(mi_arena_t*)* mi_arena_slot(size_t idx, bool create) {
+  if mi_likely(idx < MI_ARENA_CHUNK_SIZE) return &mi_arenas[idx];
+  const size_t chunk_idx = idx / MI_ARENA_CHUNK_SIZE;
+  if (chunk_idx >= MI_ARENA_CHUNKS) return NULL;
+  mi_arena_chunk_t* chunk = mi_atomic_load_ptr_acquire(mi_arena_chunk_t, &mi_arena_chunks[chunk_idx]);
+  if (chunk == NULL) {
+    if (!create) return NULL;
+    mi_memid_t memid;
+    chunk = (mi_arena_chunk_t*)_mi_arena_meta_zalloc(sizeof(mi_arena_chunk_t), &memid);
+    if (chunk == NULL) return NULL;
+    chunk->memid = memid;
+    mi_arena_chunk_t* expected = NULL;
+    if (!mi_atomic_cas_ptr_strong_release(mi_arena_chunk_t, &mi_arena_chunks[chunk_idx], &expected, chunk)) {
+      // another thread added the chunk concurrently
+      _mi_arena_meta_free(chunk, memid, sizeof(mi_arena_chunk_t));
+      chunk = expected;
+    }
+  }
+  return &chunk->arenas[idx % MI_ARENA_CHUNK_SIZE];
+}
+
+static mi_arena_t* mi_arena_at(size_t idx) {
+  _Atomic(mi_arena_t*)* slot = mi_arena_slot(idx, false);
+  return (slot == NULL ? NULL : mi_atomic_load_ptr_acquire(mi_arena_t, slot));
+}
+
+static bool mi_arena_is_released(mi_arena_t* arena) {
+  return (mi_atomic_load_acquire(&arena->release_state) != MI_ARENA_LIVE);
+}
+
+static int mi_arena_numa_node(mi_arena_t* arena) {
+  return (int)(intptr_t)mi_atomic_load_relaxed((_Atomic(uintptr_t)*)&arena->numa_node);
+}
 
 #define MI_IN_ARENA_C
 #include "arena-abandon.c"
@@ -109,7 +165,7 @@ size_t mi_arena_get_count(void) {
 
 mi_arena_t* mi_arena_from_index(size_t idx) {
   mi_assert_internal(idx < mi_arena_get_count());
-  return mi_atomic_load_ptr_acquire(mi_arena_t, &mi_arenas[idx]);
+  return mi_arena_at(idx);
 }
 
 
@@ -224,8 +280,9 @@ void* mi_arena_block_start(mi_arena_t* arena, mi_bitmap_index_t bindex) {
 // claim the `blocks_inuse` bits
 static bool mi_arena_try_claim(mi_arena_t* arena, size_t blocks, mi_bitmap_index_t* bitmap_idx)
 {
+  // we always start at the first field to keep allocations compact; the summary lets us skip full fields quickly
   size_t idx = 0; // mi_atomic_load_relaxed(&arena->search_idx);  // start from last search; ok to be relaxed as the exact start does not matter
-  if (_mi_bitmap_try_find_from_claim_across(arena->blocks_inuse, arena->field_count, idx, blocks, bitmap_idx)) {
+  if (_mi_bitmap_try_find_from_claim_across_summary(arena->blocks_inuse, arena->blocks_inuse_summary, arena->field_count, idx, blocks, bitmap_idx)) {
     mi_atomic_store_relaxed(&arena->search_idx, mi_bitmap_index_field(*bitmap_idx));  // start search from found location next time around
     return true;
   };
@@ -244,7 +301,14 @@ static mi_decl_noinline void* mi_arena_try_alloc_at(mi_arena_t* arena, size_t ar
   mi_assert_internal(mi_arena_id_index(arena->id) == arena_index);
 
   mi_bitmap_index_t bitmap_index;
-  if (!mi_arena_try_claim(arena, needed_bcount, &bitmap_index)) return NULL;
+  bool claimed = mi_arena_try_claim(arena, needed_bcount, &bitmap_index);
+  while (!claimed && mi_atomic_load_acquire(&arena->prefault_claims) > 0) {
+    // free blocks may be claimed temporarily by `mi_arena_prefault`: wait until these are released again
+    // (otherwise an allocation in an exclusive arena could fail while it is being prefaulted)
+    mi_atomic_yield();
+    claimed = mi_arena_try_claim(arena, needed_bcount, &bitmap_index);
+  }
+  if (!claimed) return NULL;
 
   // claimed it!
   void* p = mi_arena_block_start(arena, bitmap_index);
@@ -318,7 +382,8 @@ static void* mi_arena_try_alloc_at_id(mi_arena_id_t arena_id, bool match_numa_no
   if (!allow_large && arena->is_large) return NULL;
   if (!mi_arena_id_is_suitable(arena->id, arena->exclusive, req_arena_id)) return NULL;
   if (req_arena_id == _mi_arena_id_none()) { // in not specific, check numa affinity
-    const bool numa_suitable = (numa_node < 0 || arena->numa_node < 0 || arena->numa_node == numa_node);
+    const int  arena_numa_node = mi_arena_numa_node(arena);
+    const bool numa_suitable = (numa_node < 0 || arena_numa_node < 0 || arena_numa_node == numa_node);
     if (match_numa_node) { if (!numa_suitable) return NULL; }
                     else { if (numa_suitable) return NULL; }
   }
@@ -366,7 +431,11 @@ static mi_decl_noinline void* mi_arena_try_alloc(int numa_node, size_t size, siz
 }
 
 // try to reserve a fresh arena space
-static bool mi_arena_reserve(size_t req_size, bool allow_large, mi_arena_id_t *arena_id)
+static int mi_reserve_os_memory_on_node(size_t size, bool commit, bool allow_large, bool exclusive, int numa_node, mi_arena_id_t* arena_id);
+static bool mi_arena_try_reuse(size_t req_size, bool commit, int numa_node, mi_arena_id_t* arena_id);
+static long mi_arena_release_delay(void);
+
+static bool mi_arena_reserve(size_t req_size, bool allow_large, int numa_node, mi_arena_id_t *arena_id)
 {
   if (_mi_preloading()) return false;  // use OS only while pre loading
   
@@ -381,8 +450,8 @@ static bool mi_arena_reserve(size_t req_size, bool allow_large, mi_arena_id_t *a
   }
   arena_reserve = _mi_align_up(arena_reserve, MI_ARENA_BLOCK_SIZE);
   arena_reserve = _mi_align_up(arena_reserve, MI_SEGMENT_SIZE);
-  if (arena_count >= 8 && arena_count <= 128) {
-    // scale up the arena sizes exponentially every 8 entries (128 entries get to 589TiB)
+  if (arena_count >= 8) {
+    // scale up the arena sizes exponentially every 8 entries (up to 128 entries which get to 589TiB)
     const size_t multiplier = (size_t)1 << _mi_clamp(arena_count/8, 0, 16 );
     size_t reserve = 0;
     if (!mi_mul_overflow(multiplier, arena_reserve, &reserve)) {
@@ -396,18 +465,29 @@ static bool mi_arena_reserve(size_t req_size, bool allow_large, mi_arena_id_t *a
   if (mi_option_get(mi_option_arena_eager_commit) == 2)      { arena_commit = _mi_os_has_overcommit(); }
   else if (mi_option_get(mi_option_arena_eager_commit) == 1) { arena_commit = true; }
 
-  return (mi_reserve_os_memory_ex(arena_reserve, arena_commit, allow_large, false /* exclusive? */, arena_id) == 0);
+  // bind the arena to the numa node of the requesting thread?
+  if (!mi_option_is_enabled(mi_option_arena_numa_bind) || _mi_os_numa_node_count() <= 1) { numa_node = -1; }
+
+  // reuse the slot of a released idle arena?
+  if (mi_arena_try_reuse(req_size, arena_commit, numa_node, arena_id)) return true;
+
+  if (mi_reserve_os_memory_on_node(arena_reserve, arena_commit, allow_large, false /* exclusive? */, numa_node, arena_id) != 0) return false;
+  // on-demand arenas in regular OS memory can be released when they become idle
+  mi_arena_t* arena = mi_arena_at(mi_arena_id_index(*arena_id));
+  if (arena != NULL && !arena->memid.is_pinned && mi_arena_release_delay() >= 0) { arena->is_releasable = true; }
+  return true;
 }
 
 
+// Allocate from an arena; `numa_node` is the preferred NUMA node, or -1 for the node of the current thread.
 void* _mi_arena_alloc_aligned(size_t size, size_t alignment, size_t align_offset, bool commit, bool allow_large,
-                              mi_arena_id_t req_arena_id, mi_memid_t* memid)
+                              mi_arena_id_t req_arena_id, int numa_node, mi_memid_t* memid)
 {
   mi_assert_internal(memid != NULL);
   mi_assert_internal(size > 0);
   *memid = _mi_memid_none();
 
-  const int numa_node = _mi_os_numa_node(); // current numa node
+  if (numa_node < 0) { numa_node = _mi_os_numa_node(); } // current numa node
 
   // try to allocate in an arena if the alignment is small enough and the object is not too small (as for heap meta data)
   if (!mi_option_is_enabled(mi_option_disallow_arena_alloc)) {  // is arena allocation allowed?
@@ -419,7 +499,7 @@ void* _mi_arena_alloc_aligned(size_t size, size_t alignment, size_t align_offset
       // otherwise, try to first eagerly reserve a new arena
       if (req_arena_id == _mi_arena_id_none()) {
         mi_arena_id_t arena_id = 0;
-        if (mi_arena_reserve(size, allow_large, &arena_id)) {
+        if (mi_arena_reserve(size, allow_large, numa_node, &arena_id)) {
           // and try allocate in there
           mi_assert_internal(req_arena_id == _mi_arena_id_none());
           p = mi_arena_try_alloc_at_id(arena_id, true, numa_node, size, alignment, commit, allow_large, req_arena_id, memid);
@@ -446,7 +526,17 @@ void* _mi_arena_alloc_aligned(size_t size, size_t alignment, size_t align_offset
 
 void* _mi_arena_alloc(size_t size, bool commit, bool allow_large, mi_arena_id_t req_arena_id, mi_memid_t* memid)
 {
-  return _mi_arena_alloc_aligned(size, MI_ARENA_BLOCK_SIZE, 0, commit, allow_large, req_arena_id, memid);
+  return _mi_arena_alloc_aligned(size, MI_ARENA_BLOCK_SIZE, 0, commit, allow_large, req_arena_id, -1 /* current numa node */, memid);
+}
+
+// The NUMA node of the arena that the memory belongs to (or -1 if unknown)
+int _mi_arena_memid_numa_node(mi_memid_t memid) {
+  if (memid.memkind != MI_MEM_ARENA) return -1;
+  size_t arena_idx;
+  size_t bitmap_idx;
+  mi_arena_memid_indices(memid, &arena_idx, &bitmap_idx);
+  mi_arena_t* arena = mi_arena_at(arena_idx);
+  return (arena == NULL ? -1 : mi_arena_numa_node(arena));
 }
 
 
@@ -454,8 +544,8 @@ void* mi_arena_area(mi_arena_id_t arena_id, size_t* size) {
   if (size != NULL) *size = 0;
   size_t arena_index = mi_arena_id_index(arena_id);
   if (arena_index >= MI_MAX_ARENAS) return NULL;
-  mi_arena_t* arena = mi_atomic_load_ptr_acquire(mi_arena_t, &mi_arenas[arena_index]);
-  if (arena == NULL) return NULL;
+  mi_arena_t* arena = mi_arena_at(arena_index);
+  if (arena == NULL || mi_arena_is_released(arena)) return NULL;
   if (size != NULL) { *size = mi_arena_block_size(arena->block_count); }
   return arena->start;
 }
@@ -465,9 +555,11 @@ void* mi_arena_area(mi_arena_id_t arena_id, size_t* size) {
   Arena purge
 ----------------------------------------------------------- */
 
+static mi_decl_thread bool mi_purge_thread_is_self;  // true in the background purge thread
+
 static long mi_arena_purge_delay(void) {
-  // <0 = no purging allowed, 0=immediate purging, >0=milli-second delay
-  return (mi_option_get(mi_option_purge_delay) * mi_option_get(mi_option_arena_purge_mult));
+  // <0 = no purging allowed, 0=immediate purging, >0=milli-second delay (shorter under memory pressure)
+  return (_mi_os_purge_delay() * mi_option_get(mi_option_arena_purge_mult));
 }
 
 // reset or decommit in an arena and update the committed/decommit bitmaps
@@ -529,10 +621,69 @@ static void mi_arena_schedule_purge(mi_arena_t* arena, size_t bitmap_idx, size_t
   }
 }
 
+// A batch of delayed purges in an arena. We keep the `in_use` bits of the purge ranges claimed
+// until the batch is flushed, and purge all fully committed ranges at once so adjacent ranges
+// (also across bitmap fields) are coalesced into as few OS calls as possible.
+#define MI_ARENA_PURGE_BATCH  (32)
+
+typedef struct mi_arena_purge_batch_s {
+  size_t            claim_count;
+  mi_bitmap_index_t claim_idx[MI_ARENA_PURGE_BATCH];
+  size_t            claim_blocks[MI_ARENA_PURGE_BATCH];
+  size_t            range_count;
+  mi_bitmap_index_t range_idx[MI_ARENA_PURGE_BATCH];
+  size_t            range_blocks[MI_ARENA_PURGE_BATCH];
+} mi_arena_purge_batch_t;
+
+// purge all ranges in the batch (but keep the claims)
+static void mi_arena_purge_batch_ranges(mi_arena_t* arena, mi_arena_purge_batch_t* batch) {
+  if (batch->range_count == 0) return;
+  mi_os_range_t ranges[MI_ARENA_PURGE_BATCH];
+  for (size_t i = 0; i < batch->range_count; i++) {
+    ranges[i].start = mi_arena_block_start(arena, batch->range_idx[i]);
+    ranges[i].size  = mi_arena_block_size(batch->range_blocks[i]);
+  }
+  const bool needs_recommit = _mi_os_purge_ranges(ranges, batch->range_count);
+  for (size_t i = 0; i < batch->range_count; i++) {
+    // clear the purged blocks and update the committed bitmap
+    _mi_bitmap_unclaim_across(arena->blocks_purge, arena->field_count, batch->range_blocks[i], batch->range_idx[i]);
+    if (needs_recommit) {
+      _mi_bitmap_unclaim_across(arena->blocks_committed, arena->field_count, batch->range_blocks[i], batch->range_idx[i]);
+    }
+  }
+  batch->range_count = 0;
+}
+
+// purge all ranges in the batch and release the claimed `in_use` bits
+static void mi_arena_purge_batch_flush(mi_arena_t* arena, mi_arena_purge_batch_t* batch) {
+  mi_arena_purge_batch_ranges(arena, batch);
+  for (size_t i = 0; i < batch->claim_count; i++) {
+    _mi_bitmap_unclaim_across_summary(arena->blocks_inuse, arena->blocks_inuse_summary, arena->field_count, batch->claim_blocks[i], batch->claim_idx[i]);
+  }
+  batch->claim_count = 0;
+}
+
+// add a range of blocks to be purged to the batch
+// assumes we own the area (i.e. blocks_in_use is claimed by us)
+static void mi_arena_purge_batch_add(mi_arena_t* arena, mi_arena_purge_batch_t* batch, mi_bitmap_index_t bitmap_idx, size_t blocks) {
+  size_t already_committed = 0;
+  if (!_mi_bitmap_is_claimed_across(arena->blocks_committed, arena->field_count, blocks, bitmap_idx, &already_committed)) {
+    // partially committed ranges are purged separately
+    mi_arena_purge(arena, bitmap_idx, blocks);
+    return;
+  }
+  if (batch->range_count >= MI_ARENA_PURGE_BATCH) {
+    mi_arena_purge_batch_ranges(arena, batch);
+  }
+  batch->range_idx[batch->range_count] = bitmap_idx;
+  batch->range_blocks[batch->range_count] = blocks;
+  batch->range_count++;
+}
+
 // purge a range of blocks
 // return true if the full range was purged.
 // assumes we own the area (i.e. blocks_in_use is claimed by us)
-static bool mi_arena_purge_range(mi_arena_t* arena, size_t idx, size_t startidx, size_t bitlen, size_t purge) {
+static bool mi_arena_purge_range(mi_arena_t* arena, mi_arena_purge_batch_t* batch, size_t idx, size_t startidx, size_t bitlen, size_t purge) {
   const size_t endidx = startidx + bitlen;
   size_t bitidx = startidx;
   bool all_purged = false;
@@ -545,7 +696,7 @@ static bool mi_arena_purge_range(mi_arena_t* arena, size_t idx, size_t startidx,
     if (count > 0) {
       // found range to be purged
       const mi_bitmap_index_t range_idx = mi_bitmap_index_create(idx, bitidx);
-      mi_arena_purge(arena, range_idx, count);
+      mi_arena_purge_batch_add(arena, batch, range_idx, count);
       if (count == bitlen) {
         all_purged = true;
       }
@@ -572,6 +723,9 @@ static bool mi_arena_try_purge(mi_arena_t* arena, mi_msecs_t now, bool force)
   // potential purges scheduled, walk through the bitmap
   bool any_purged = false;
   bool full_purge = true;
+  mi_arena_purge_batch_t batch;
+  batch.claim_count = 0;
+  batch.range_count = 0;
   for (size_t i = 0; i < arena->field_count; i++) {
     size_t purge = mi_atomic_load_relaxed(&arena->blocks_purge[i]);
     if (purge != 0) {
@@ -584,6 +738,9 @@ static bool mi_arena_try_purge(mi_arena_t* arena, mi_msecs_t now, bool force)
         }
         // temporarily claim the purge range as "in-use" to be thread-safe with allocation
         // try to claim the longest range of corresponding in_use bits
+        if (batch.claim_count >= MI_ARENA_PURGE_BATCH) {
+          mi_arena_purge_batch_flush(arena, &batch);
+        }
         const mi_bitmap_index_t bitmap_index = mi_bitmap_index_create(i, bitidx);
         while( bitlen > 0 ) {
           if (_mi_bitmap_try_claim(arena->blocks_inuse, arena->field_count, bitlen, bitmap_index)) {
@@ -595,17 +752,20 @@ static bool mi_arena_try_purge(mi_arena_t* arena, mi_msecs_t now, bool force)
         if (bitlen > 0) {
           // read purge again now that we have the in_use bits
           purge = mi_atomic_load_acquire(&arena->blocks_purge[i]);
-          if (!mi_arena_purge_range(arena, i, bitidx, bitlen, purge)) {
+          if (!mi_arena_purge_range(arena, &batch, i, bitidx, bitlen, purge)) {
             full_purge = false;
           }
           any_purged = true;
-          // release the claimed `in_use` bits again
-          _mi_bitmap_unclaim(arena->blocks_inuse, arena->field_count, bitlen, bitmap_index);
+          // the claimed `in_use` bits are released again when the batch is flushed
+          batch.claim_idx[batch.claim_count] = bitmap_index;
+          batch.claim_blocks[batch.claim_count] = bitlen;
+          batch.claim_count++;
         }
         bitidx += (bitlen+1);  // +1 to skip the zero (or end)
       } // while bitidx
     } // purge != 0
   }
+  mi_arena_purge_batch_flush(arena, &batch);
   // if not fully purged, make sure to purge again in the future
   if (!full_purge) {
     const long delay = mi_arena_purge_delay();
@@ -615,9 +775,13 @@ static bool mi_arena_try_purge(mi_arena_t* arena, mi_msecs_t now, bool force)
   return any_purged;
 }
 
+static void mi_arenas_try_release(bool force);
+
 static void mi_arenas_try_purge( bool force, bool visit_all ) 
 {
+  mi_arenas_try_release(force);
   if (_mi_preloading() || mi_arena_purge_delay() <= 0) return;  // nothing will be scheduled
+  if (!force && !mi_purge_thread_is_self && _mi_purge_thread_is_active()) return;  // leave it to the background thread
 
   // check if any arena needs purging?
   const mi_msecs_t now = _mi_clock_now();
@@ -636,7 +800,7 @@ static void mi_arenas_try_purge( bool force, bool visit_all )
     size_t max_purge_count = (visit_all ? max_arena : 2);
     bool all_visited = true;
     for (size_t i = 0; i < max_arena; i++) {
-      mi_arena_t* arena = mi_atomic_load_ptr_acquire(mi_arena_t, &mi_arenas[i]);
+      mi_arena_t* arena = mi_arena_at(i);
       if (arena != NULL) {
         if (mi_arena_try_purge(arena, now, force)) {
           if (max_purge_count <= 1) {
@@ -655,6 +819,154 @@ static void mi_arenas_try_purge( bool force, bool visit_all )
 }
 
 
+/* -----------------------------------------------------------
+  Release idle arenas (`mi_option_arena_release_delay`)
+
+  Arenas that were reserved on demand from the OS are released
+  (unmapped) once they were completely free for the release delay.
+  The arena descriptor stays in the arena table (as other threads
+  may still read it) with all its blocks claimed as in-use so no
+  allocation can happen in it, and its slot is reused (with fresh
+  OS memory) on the next on-demand reservation.
+----------------------------------------------------------- */
+
+static long mi_arena_release_delay(void) {
+  return mi_option_get(mi_option_arena_release_delay);
+}
+
+static void mi_arenas_schedule_release(void) {
+  const long delay = mi_arena_release_delay();
+  if (delay < 0) return;
+  mi_msecs_t expire0 = 0;
+  mi_atomic_casi64_strong_acq_rel(&mi_arenas_release_expire, &expire0, _mi_clock_now() + delay);
+}
+
+// The value of the in-use bitmap field `i` of an arena that is completely free
+static size_t mi_arena_inuse_free_field(mi_arena_t* arena, size_t i) {
+  const size_t post = (arena->field_count * MI_BITMAP_FIELD_BITS) - arena->block_count;
+  if (i + 1 < arena->field_count || post == 0) return 0;
+  return (MI_BITMAP_FIELD_FULL << (MI_BITMAP_FIELD_BITS - post));  // the unused bits at the end are always claimed
+}
+
+static bool mi_arena_is_idle(mi_arena_t* arena) {
+  for (size_t i = 0; i < arena->field_count; i++) {
+    if (mi_atomic_load_relaxed(&arena->blocks_inuse[i]) != mi_arena_inuse_free_field(arena, i)) return false;
+  }
+  return true;
+}
+
+// Try to release the memory of an idle arena; returns `true` on success.
+static bool mi_arena_try_release(mi_arena_t* arena) {
+  mi_assert_internal(arena->is_releasable && arena->blocks_committed != NULL && arena->blocks_purge != NULL);
+  // atomically claim all blocks so no allocation (or purge) can happen in the arena
+  size_t claimed = 0;
+  for (; claimed < arena->field_count; claimed++) {
+    size_t expected = mi_arena_inuse_free_field(arena, claimed);
+    if (!mi_atomic_cas_strong_acq_rel(&arena->blocks_inuse[claimed], &expected, MI_BITMAP_FIELD_FULL)) break;
+  }
+  if (claimed < arena->field_count) {
+    // not idle after all, roll back (the claimed fields are never the last one so all their bits were free);
+    // this also sets their summary bits again as they may have been cleared by a concurrent search in the mean time
+    if (claimed > 0) {
+      _mi_bitmap_unclaim_across_summary(arena->blocks_inuse, arena->blocks_inuse_summary, arena->field_count, claimed * MI_BITMAP_FIELD_BITS, 0);
+    }
+    return false;
+  }
+  // no segments can be abandoned in it as all blocks are free
+  mi_assert_internal(!_mi_bitmap_is_any_claimed_across(arena->blocks_abandoned, arena->field_count, arena->block_count, 0));
+  size_t committed_blocks = 0;
+  for (size_t i = 0; i < arena->field_count; i++) {
+    committed_blocks += mi_popcount(mi_atomic_load_relaxed(&arena->blocks_committed[i]) & ~mi_arena_inuse_free_field(arena, i));
+    mi_atomic_store_relaxed(&arena->blocks_purge[i], (size_t)0);
+  }
+  mi_atomic_storei64_release(&arena->purge_expire, (mi_msecs_t)0);
+  mi_atomic_store_release(&arena->release_state, (size_t)MI_ARENA_RELEASED);
+  // and unmap the memory
+  _mi_stat_decrease(&_mi_stats_main.committed, mi_arena_block_size(committed_blocks));
+  _mi_os_free_ex(arena->start, mi_arena_size(arena), false /* still committed */, arena->memid);
+  _mi_verbose_message("released idle arena %zu of %zu KiB\n", mi_arena_id_index(arena->id), mi_arena_size(arena) / MI_KiB);
+  return true;
+}
+
+static void mi_arenas_try_release(bool force) {
+  const long delay = mi_arena_release_delay();
+  if (_mi_preloading() || delay < 0) return;
+  if (!force && !mi_purge_thread_is_self && _mi_purge_thread_is_active()) return;  // leave it to the background thread
+
+  const mi_msecs_t now = _mi_clock_now();
+  mi_msecs_t expire = mi_atomic_loadi64_acquire(&mi_arenas_release_expire);
+  if (expire == 0 || (!force && expire > now)) return;
+  if (!mi_atomic_casi64_strong_acq_rel(&mi_arenas_release_expire, &expire, (mi_msecs_t)0)) return;  // another thread is checking
+
+  // visit all releasable arenas
+  bool pending = false;
+  const size_t max_arena = mi_atomic_load_acquire(&mi_arena_count);
+  for (size_t i = 0; i < max_arena; i++) {
+    mi_arena_t* arena = mi_arena_at(i);
+    if (arena == NULL || !arena->is_releasable || mi_arena_is_released(arena)) continue;
+    if (!mi_arena_is_idle(arena)) {
+      mi_atomic_storei64_relaxed(&arena->idle_since, (mi_msecs_t)0);
+      continue;
+    }
+    mi_msecs_t idle_since = mi_atomic_loadi64_relaxed(&arena->idle_since);
+    if (idle_since == 0) {
+      mi_atomic_storei64_relaxed(&arena->idle_since, now);
+      pending = (delay > 0 || !mi_arena_try_release(arena));
+    }
+    else if (now - idle_since >= delay) {
+      pending = !mi_arena_try_release(arena) || pending;
+    }
+    else {
+      pending = true;
+    }
+  }
+  if (pending) { mi_arenas_schedule_release(); }
+}
+
+// Try to reuse the slot of a released arena with fresh OS memory (of the same size as before)
+static bool mi_arena_try_reuse(size_t req_size, bool commit, int numa_node, mi_arena_id_t* arena_id) {
+  const size_t max_arena = mi_atomic_load_acquire(&mi_arena_count);
+  for (size_t i = 0; i < max_arena; i++) {
+    mi_arena_t* arena = mi_arena_at(i);
+    if (arena == NULL || !arena->is_releasable || mi_arena_size(arena) < req_size) continue;
+    size_t expected = MI_ARENA_RELEASED;
+    if (!mi_atomic_cas_strong_acq_rel(&arena->release_state, &expected, (size_t)MI_ARENA_REUSING)) continue;
+    // reserve fresh memory
+    const size_t size = mi_arena_size(arena);
+    mi_memid_t memid;
+    void* start = _mi_os_alloc_aligned(size, MI_SEGMENT_ALIGN, commit, false /* allow large */, &memid);
+    if (start == NULL) {
+      mi_atomic_store_release(&arena->release_state, (size_t)MI_ARENA_RELEASED);
+      return false;
+    }
+    mi_assert_internal(!memid.is_pinned);
+    if (numa_node >= 0 && !_mi_os_numa_bind(start, size, numa_node)) { numa_node = -1; }
+    // re-initialize the arena; other threads cannot allocate in it yet as all blocks are still claimed.
+    // only the OS info and initial state of the memid change (and these are only read by threads that claimed blocks);
+    // `is_pinned` and `memkind` stay the same as these are read without claiming blocks.
+    mi_assert_internal(memid.memkind == arena->memid.memkind);
+    arena->memid.mem = memid.mem;
+    arena->memid.initially_committed = memid.initially_committed;
+    arena->memid.initially_zero = memid.initially_zero;
+    mi_atomic_store_ptr_release(uint8_t, &arena->start, (uint8_t*)start);
+    mi_atomic_store_relaxed((_Atomic(uintptr_t)*)&arena->numa_node, (uintptr_t)(intptr_t)numa_node);
+    for (size_t f = 0; f < arena->field_count; f++) {
+      mi_atomic_store_relaxed(&arena->blocks_dirty[f], (size_t)0);
+      mi_atomic_store_relaxed(&arena->blocks_committed[f], (memid.initially_committed ? MI_BITMAP_FIELD_FULL : 0));
+      mi_atomic_store_relaxed(&arena->blocks_purge[f], (size_t)0);
+    }
+    mi_atomic_storei64_relaxed(&arena->idle_since, (mi_msecs_t)0);
+    mi_atomic_store_release(&arena->release_state, (size_t)MI_ARENA_LIVE);
+    // and make the blocks available (the release ordering of the unclaim publishes the updates above)
+    _mi_bitmap_unclaim_across_summary(arena->blocks_inuse, arena->blocks_inuse_summary, arena->field_count, arena->block_count, 0);
+    _mi_verbose_message("reused arena %zu with %zu KiB memory\n", i, size / MI_KiB);
+    if (arena_id != NULL) { *arena_id = arena->id; }
+    return true;
+  }
+  return false;
+}
+
+
 /* -----------------------------------------------------------
   Arena free
 ----------------------------------------------------------- */
@@ -684,7 +996,7 @@ void _mi_arena_free(void* p, size_t size, size_t committed_size, mi_memid_t memi
     size_t bitmap_idx;
     mi_arena_memid_indices(memid, &arena_idx, &bitmap_idx);
     mi_assert_internal(arena_idx < MI_MAX_ARENAS);
-    mi_arena_t* arena = mi_atomic_load_ptr_acquire(mi_arena_t,&mi_arenas[arena_idx]);
+    mi_arena_t* arena = mi_arena_at(arena_idx);
     mi_assert_internal(arena != NULL);
     const size_t blocks = mi_block_count_of_size(size);
 
@@ -725,11 +1037,13 @@ void _mi_arena_free(void* p, size_t size, size_t committed_size, mi_memid_t memi
     }
 
     // and make it available to others again
-    bool all_inuse = _mi_bitmap_unclaim_across(arena->blocks_inuse, arena->field_count, blocks, bitmap_idx);
+    bool all_inuse = _mi_bitmap_unclaim_across_summary(arena->blocks_inuse, arena->blocks_inuse_summary, arena->field_count, blocks, bitmap_idx);
     if (!all_inuse) {
       _mi_error_message(EAGAIN, "trying to free an already freed arena block: %p, size %zu\n", p, size);
       return;
     };
+    // the arena may have become idle
+    if (arena->is_releasable) { mi_arenas_schedule_release(); }
   }
   else {
     // arena was none, external, or static; nothing to do
@@ -746,12 +1060,14 @@ static void mi_arenas_unsafe_destroy(void) {
   const size_t max_arena = mi_atomic_load_relaxed(&mi_arena_count);
   size_t new_max_arena = 0;
   for (size_t i = 0; i < max_arena; i++) {
-    mi_arena_t* arena = mi_atomic_load_ptr_acquire(mi_arena_t, &mi_arenas[i]);
+    mi_arena_t* arena = mi_arena_at(i);
     if (arena != NULL) {
       mi_lock_done(&arena->abandoned_visit_lock);
       if (arena->start != NULL && mi_memkind_is_os(arena->memid.memkind)) {
-        mi_atomic_store_ptr_release(mi_arena_t, &mi_arenas[i], NULL);
-        _mi_os_free(arena->start, mi_arena_size(arena), arena->memid);
+        mi_atomic_store_ptr_release(mi_arena_t, mi_arena_slot(i, false), NULL);
+        if (!mi_arena_is_released(arena)) {
+          _mi_os_free(arena->start, mi_arena_size(arena), arena->memid);
+        }
       }
       else {
         new_max_arena = i;
@@ -770,6 +1086,65 @@ void _mi_arenas_collect(bool force_purge) {
   mi_arenas_try_purge(force_purge, force_purge /* visit all? */);
 }
 
+/* -----------------------------------------------------------
+  Background purge thread (`mi_option_purge_thread`): does the
+  delayed purging of arenas and abandoned segments, and collects
+  the thread data cache, so allocating threads do not need to.
+  (Purging of segments that are owned by a thread is still done
+  by the owning thread.)
+  The same thread also does asynchronous huge OS page reservations
+  (see `mi_reserve_huge_os_pages_interleave_async`).
+----------------------------------------------------------- */
+
+static bool mi_purge_thread_enabled;  // does the background thread purge? (it may run for huge page reservation only)
+
+static bool mi_huge_reserve_async_step(void);
+
+static mi_msecs_t mi_purge_thread_step(void) {
+  if (!mi_purge_thread_is_self) {
+    mi_purge_thread_is_self = true;
+    mi_thread_init();
+  }
+  // reserve huge OS pages for one numa node at a time, and continue right away
+  if (mi_huge_reserve_async_step()) return 1;
+  if (!mi_purge_thread_enabled) return -1;  // only started for the huge page reservation: exit when that is done
+
+  mi_heap_t* const heap = mi_heap_get_default();
+  const bool critical = (_mi_os_memory_pressure_check(false) && _mi_os_memory_pressure() >= 2);
+  if (critical) { _mi_heap_recycle_collect(); }  // abandon parked heaps so their free space can be purged
+  _mi_abandoned_collect(heap, critical /* force? */, &heap->tld->segments);
+  mi_arenas_try_purge(critical, true /* visit all */);
+  _mi_thread_data_collect();
+  // wake up again after the arena purge delay (bounded between 10ms and 1s)
+  const long delay = mi_arena_purge_delay();
+  return (delay <= 0 || delay > 1000 ? 1000 : (delay < 10 ? 10 : delay));
+}
+
+// wake up the background thread (so it picks up new work right away), or start it if it is not running
+static bool mi_bgthread_ensure_started(void) {
+  return (_mi_prim_bgthread_wakeup() || _mi_prim_bgthread_start(&mi_purge_thread_step));
+}
+
+void _mi_purge_thread_start(void) {
+  if (!mi_option_is_enabled(mi_option_purge_thread) || _mi_purge_thread_is_active()) return;
+  mi_purge_thread_enabled = true;
+  if (mi_bgthread_ensure_started()) {
+    _mi_verbose_message("started background purge thread\n");
+  }
+  else {
+    mi_purge_thread_enabled = false;
+    _mi_warning_message("unable to start the background purge thread\n");
+  }
+}
+
+void _mi_purge_thread_stop(void) {
+  _mi_prim_bgthread_stop();
+}
+
+bool _mi_purge_thread_is_active(void) {
+  return (mi_purge_thread_enabled && _mi_prim_bgthread_is_running());
+}
+
 // destroy owned arenas; this is unsafe and should only be done using `mi_option_destroy_on_exit`
 // for dynamic libraries that are unloaded and need to release all their allocated memory.
 void _mi_arena_unsafe_destroy_all(void) {
@@ -781,8 +1156,8 @@ void _mi_arena_unsafe_destroy_all(void) {
 bool _mi_arena_contains(const void* p) {
   const size_t max_arena = mi_atomic_load_relaxed(&mi_arena_count);
   for (size_t i = 0; i < max_arena; i++) {
-    mi_arena_t* arena = mi_atomic_load_ptr_relaxed(mi_arena_t, &mi_arenas[i]);
-    if (arena != NULL && arena->start <= (const uint8_t*)p && arena->start + mi_arena_block_size(arena->block_count) > (const uint8_t*)p) {
+    mi_arena_t* arena = mi_arena_at(i);
+    if (arena != NULL && !mi_arena_is_released(arena) && arena->start <= (const uint8_t*)p && arena->start + mi_arena_block_size(arena->block_count) > (const uint8_t*)p) {
       return true;
     }
   }
@@ -800,13 +1175,14 @@ static bool mi_arena_add(mi_arena_t* arena, mi_arena_id_t* arena_id, mi_stats_t*
   if (arena_id != NULL) { *arena_id = -1; }
 
   size_t i = mi_atomic_increment_acq_rel(&mi_arena_count);
-  if (i >= MI_MAX_ARENAS) {
+  _Atomic(mi_arena_t*)* slot = (i >= MI_MAX_ARENAS ? NULL : mi_arena_slot(i, true /* create */));
+  if (slot == NULL) {
     mi_atomic_decrement_acq_rel(&mi_arena_count);
     return false;
   }
   _mi_stat_counter_increase(&stats->arena_count,1);
   arena->id = mi_arena_id_create(i);
-  mi_atomic_store_ptr_release(mi_arena_t,&mi_arenas[i], arena);
+  mi_atomic_store_ptr_release(mi_arena_t, slot, arena);
   if (arena_id != NULL) { *arena_id = arena->id; }
   return true;
 }
@@ -835,7 +1211,7 @@ static bool mi_manage_os_memory_ex2(void* start, size_t size, bool is_large, int
   const size_t bcount = size / MI_ARENA_BLOCK_SIZE;
   const size_t fields = _mi_divide_up(bcount, MI_BITMAP_FIELD_BITS);
   const size_t bitmaps = (memid.is_pinned ? 3 : 5);
-  const size_t asize  = sizeof(mi_arena_t) + (bitmaps*fields*sizeof(mi_bitmap_field_t));
+  const size_t asize  = sizeof(mi_arena_t) + ((bitmaps*fields + mi_bitmap_summary_fields(fields))*sizeof(mi_bitmap_field_t));
   mi_memid_t meta_memid;
   mi_arena_t* arena   = (mi_arena_t*)_mi_arena_meta_zalloc(asize, &meta_memid);
   if (arena == NULL) return false;
@@ -850,7 +1226,7 @@ static bool mi_manage_os_memory_ex2(void* start, size_t size, bool is_large, int
   arena->block_count = bcount;
   arena->field_count = fields;
   arena->start = (uint8_t*)start;
-  arena->numa_node    = numa_node; // TODO: or get the current numa node if -1? (now it allows anyone to allocate on -1)
+  arena->numa_node    = (intptr_t)numa_node; // TODO: or get the current numa node if -1? (now it allows anyone to allocate on -1)
   arena->is_large     = is_large;
   arena->purge_expire = 0;
   arena->search_idx   = 0;
@@ -860,6 +1236,8 @@ static bool mi_manage_os_memory_ex2(void* start, size_t size, bool is_large, int
   arena->blocks_abandoned = &arena->blocks_inuse[2 * fields]; // just after dirty bitmap
   arena->blocks_committed = (arena->memid.is_pinned ? NULL : &arena->blocks_inuse[3*fields]); // just after abandoned bitmap
   arena->blocks_purge     = (arena->memid.is_pinned ? NULL : &arena->blocks_inuse[4*fields]); // just after committed bitmap
+  arena->blocks_inuse_summary = &arena->blocks_inuse[bitmaps*fields]; // after the last bitmap
+  _mi_bitmap_summary_init(arena->blocks_inuse_summary, fields);
   // initialize committed bitmap?
   if (arena->blocks_committed != NULL && arena->memid.initially_committed) {
     memset((void*)arena->blocks_committed, 0xFF, fields*sizeof(mi_bitmap_field_t)); // cast to void* to avoid atomic warning
@@ -886,14 +1264,18 @@ bool mi_manage_os_memory_ex(void* start, size_t size, bool is_committed, bool is
 }
 
 // Reserve a range of regular OS memory
-int mi_reserve_os_memory_ex(size_t size, bool commit, bool allow_large, bool exclusive, mi_arena_id_t* arena_id) mi_attr_noexcept {
+// Reserve a range of regular OS memory; if `numa_node >= 0` the memory is bound to that numa node
+static int mi_reserve_os_memory_on_node(size_t size, bool commit, bool allow_large, bool exclusive, int numa_node, mi_arena_id_t* arena_id) {
   if (arena_id != NULL) *arena_id = _mi_arena_id_none();
   size = _mi_align_up(size, MI_ARENA_BLOCK_SIZE); // at least one block
   mi_memid_t memid;
   void* start = _mi_os_alloc_aligned(size, MI_SEGMENT_ALIGN, commit, allow_large, &memid);
   if (start == NULL) return ENOMEM;
   const bool is_large = memid.is_pinned; // todo: use separate is_large field?
-  if (!mi_manage_os_memory_ex2(start, size, is_large, -1 /* numa node */, exclusive, memid, arena_id)) {
+  if (numa_node >= 0 && !_mi_os_numa_bind(start, size, numa_node)) {
+    numa_node = -1;  // binding failed: usable from any node
+  }
+  if (!mi_manage_os_memory_ex2(start, size, is_large, numa_node, exclusive, memid, arena_id)) {
     _mi_os_free_ex(start, size, commit, memid);
     _mi_verbose_message("failed to reserve %zu KiB memory\n", _mi_divide_up(size, 1024));
     return ENOMEM;
@@ -902,6 +1284,16 @@ int mi_reserve_os_memory_ex(size_t size, bool commit, bool allow_large, bool exc
   return 0;
 }
 
+int mi_reserve_os_memory_ex(size_t size, bool commit, bool allow_large, bool exclusive, mi_arena_id_t* arena_id) mi_attr_noexcept {
+  mi_arena_id_t id;
+  const int err = mi_reserve_os_memory_on_node(size, commit, allow_large, exclusive, -1 /* numa node */, &id);
+  if (arena_id != NULL) { *arena_id = id; }
+  if (err == 0 && commit && mi_option_is_enabled(mi_option_arena_prefault)) {
+    mi_arena_prefault(id, (size_t)mi_option_get_clamp(mi_option_arena_prefault, 1, 64));
+  }
+  return err;
+}
+
 
 // Manage a range of regular OS memory
 bool mi_manage_os_memory(void* start, size_t size, bool is_committed, bool is_large, bool is_zero, int numa_node) mi_attr_noexcept {
@@ -914,6 +1306,64 @@ int mi_reserve_os_memory(size_t size, bool commit, bool allow_large) mi_attr_noe
 }
 
 
+/* -----------------------------------------------------------
+  Pre-fault committed arena memory ahead of use, so first
+  touch page faults do not happen in the allocating threads.
+  Each helper thread claims one free block at a time (so it
+  cannot be allocated or purged concurrently), populates it,
+  and releases it again. Blocks in use are skipped. Allocations
+  in the arena wait for such temporary claims to be released
+  (see `mi_arena_try_alloc_at`).
+----------------------------------------------------------- */
+
+typedef struct mi_arena_prefault_s {
+  mi_arena_t*     arena;
+  _Atomic(size_t) next;       // next block index to visit
+  _Atomic(size_t) populated;  // number of populated blocks
+} mi_arena_prefault_t;
+
+static void mi_arena_prefault_worker(size_t thread_idx, void* arg) {
+  MI_UNUSED(thread_idx);
+  mi_arena_prefault_t* pf = (mi_arena_prefault_t*)arg;
+  mi_arena_t* const arena = pf->arena;
+  size_t block;
+  while ((block = mi_atomic_add_acq_rel(&pf->next, 1)) < arena->block_count) {
+    const mi_bitmap_index_t bitmap_idx = mi_bitmap_index_create_from_bit(block);
+    if (!_mi_bitmap_is_claimed(arena->blocks_committed, arena->field_count, 1, bitmap_idx)) continue;
+    // count the claim before making it so an allocation that fails to claim the block knows to wait
+    mi_atomic_increment_acq_rel(&arena->prefault_claims);
+    if (_mi_bitmap_try_claim(arena->blocks_inuse, arena->field_count, 1, bitmap_idx)) {  // not in use?
+      if (_mi_bitmap_is_claimed(arena->blocks_committed, arena->field_count, 1, bitmap_idx)) {  // not purged in the mean time?
+        _mi_os_populate(mi_arena_block_start(arena, bitmap_idx), MI_ARENA_BLOCK_SIZE);
+        mi_atomic_increment_relaxed(&pf->populated);
+      }
+      _mi_bitmap_unclaim_across_summary(arena->blocks_inuse, arena->blocks_inuse_summary, arena->field_count, 1, bitmap_idx);
+    }
+    mi_atomic_decrement_acq_rel(&arena->prefault_claims);
+  }
+}
+
+// Populate the committed (and free) memory of an arena using `nthreads` threads (including the calling one).
+// Returns 0 on success, or `ENOENT` if the arena does not exist.
+int mi_arena_prefault(mi_arena_id_t arena_id, size_t nthreads) mi_attr_noexcept {
+  const size_t arena_idx = mi_arena_id_index(arena_id);
+  mi_arena_t* arena = (arena_idx < MI_MAX_ARENAS ? mi_arena_at(arena_idx) : NULL);
+  if (arena == NULL || mi_arena_is_released(arena)) return ENOENT;
+  if (arena->memid.is_pinned || arena->blocks_committed == NULL) return 0;  // pinned memory is always resident
+  if (nthreads == 0) { nthreads = 1; }
+  if (nthreads > arena->block_count) { nthreads = arena->block_count; }
+  mi_arena_prefault_t pf;
+  pf.arena = arena;
+  mi_atomic_store_relaxed(&pf.next, (size_t)0);
+  mi_atomic_store_relaxed(&pf.populated, (size_t)0);
+  const mi_msecs_t start = _mi_clock_now();
+  const size_t used = _mi_prim_run_parallel(nthreads, &mi_arena_prefault_worker, &pf);
+  _mi_verbose_message("prefaulted %zu MiB of arena %zu using %zu threads in %lld ms\n",
+                      mi_arena_block_size(mi_atomic_load_relaxed(&pf.populated)) / MI_MiB, arena_idx, used, (long long)(_mi_clock_now() - start));
+  return 0;
+}
+
+
 /* -----------------------------------------------------------
   Debugging
 ----------------------------------------------------------- */
@@ -949,7 +1399,7 @@ void mi_debug_show_arenas(void) mi_attr_noexcept {
   //size_t abandoned_total = 0;
   //size_t purge_total = 0;
   for (size_t i = 0; i < max_arenas; i++) {
-    mi_arena_t* arena = mi_atomic_load_ptr_relaxed(mi_arena_t, &mi_arenas[i]);
+    mi_arena_t* arena = mi_arena_at(i);
     if (arena == NULL) break;
     _mi_message("arena %zu: %zu blocks of size %zuMiB (in %zu fields) %s\n", i, arena->block_count, MI_ARENA_BLOCK_SIZE / MI_MiB, arena->field_count, (arena->memid.is_pinned ? ", pinned" : ""));
     if (show_inuse) {
@@ -980,28 +1430,35 @@ void mi_arenas_print(void) mi_attr_noexcept {
   Reserve a huge page arena.
 ----------------------------------------------------------- */
 // reserve at a specific numa node
-int mi_reserve_huge_os_pages_at_ex(size_t pages, int numa_node, size_t timeout_msecs, bool exclusive, mi_arena_id_t* arena_id) mi_attr_noexcept {
+static int mi_reserve_huge_os_pages_on_node(size_t pages, int numa_node, size_t timeout_msecs, bool exclusive, mi_arena_id_t* arena_id, size_t* pages_reserved) {
   if (arena_id != NULL) *arena_id = -1;
+  *pages_reserved = 0;
   if (pages==0) return 0;
   if (numa_node < -1) numa_node = -1;
   if (numa_node >= 0) numa_node = numa_node % _mi_os_numa_node_count();
   size_t hsize = 0;
-  size_t pages_reserved = 0;
+  size_t reserved = 0;
   mi_memid_t memid;
-  void* p = _mi_os_alloc_huge_os_pages(pages, numa_node, timeout_msecs, &pages_reserved, &hsize, &memid);
-  if (p==NULL || pages_reserved==0) {
+  void* p = _mi_os_alloc_huge_os_pages(pages, numa_node, timeout_msecs, &reserved, &hsize, &memid);
+  if (p==NULL || reserved==0) {
     _mi_warning_message("failed to reserve %zu GiB huge pages\n", pages);
     return ENOMEM;
   }
-  _mi_verbose_message("numa node %i: reserved %zu GiB huge pages (of the %zu GiB requested)\n", numa_node, pages_reserved, pages);
+  _mi_verbose_message("numa node %i: reserved %zu GiB huge pages (of the %zu GiB requested)\n", numa_node, reserved, pages);
 
   if (!mi_manage_os_memory_ex2(p, hsize, true, numa_node, exclusive, memid, arena_id)) {
     _mi_os_free(p, hsize, memid);
     return ENOMEM;
   }
+  *pages_reserved = reserved;
   return 0;
 }
 
+int mi_reserve_huge_os_pages_at_ex(size_t pages, int numa_node, size_t timeout_msecs, bool exclusive, mi_arena_id_t* arena_id) mi_attr_noexcept {
+  size_t pages_reserved = 0;
+  return mi_reserve_huge_os_pages_on_node(pages, numa_node, timeout_msecs, exclusive, arena_id, &pages_reserved);
+}
+
 int mi_reserve_huge_os_pages_at(size_t pages, int numa_node, size_t timeout_msecs) mi_attr_noexcept {
   return mi_reserve_huge_os_pages_at_ex(pages, numa_node, timeout_msecs, false, NULL);
 }
@@ -1034,6 +1491,87 @@ int mi_reserve_huge_os_pages_interleave(size_t pages, size_t numa_nodes, size_t
   return 0;
 }
 
+
+/* -----------------------------------------------------------
+  Asynchronous huge page reservation: the background thread
+  reserves the huge pages one numa node at a time, and each
+  arena becomes available for allocation as soon as it is added.
+  In the mean time, allocation proceeds from regular arenas.
+----------------------------------------------------------- */
+
+static mi_decl_cache_align _Atomic(size_t) mi_huge_reserve_pending;   // numa nodes still to visit (0 if done)
+static _Atomic(size_t)  mi_huge_reserve_reserved;  // pages reserved so far
+static _Atomic(size_t)  mi_huge_reserve_err;       // the first error (or 0)
+static size_t           mi_huge_reserve_pages;     // the reservation request
+static size_t           mi_huge_reserve_numa_first;
+static size_t           mi_huge_reserve_numa_count;
+static size_t           mi_huge_reserve_timeout_per;
+
+// Reserve the pages for the next numa node; returns `false` if there was nothing pending.
+static bool mi_huge_reserve_async_step(void) {
+  const size_t pending = mi_atomic_load_acquire(&mi_huge_reserve_pending);
+  if (pending == 0 || pending == SIZE_MAX) return false;  // nothing to do, or a request is being set up
+  // reserve evenly among numa nodes (as in `mi_reserve_huge_os_pages_interleave`)
+  const size_t idx = mi_huge_reserve_numa_count - pending;
+  const size_t node_pages = (mi_huge_reserve_pages / mi_huge_reserve_numa_count) + (idx < (mi_huge_reserve_pages % mi_huge_reserve_numa_count) ? 1 : 0);
+  size_t pages_reserved = 0;
+  const int err = mi_reserve_huge_os_pages_on_node(node_pages, (int)(mi_huge_reserve_numa_first + idx), mi_huge_reserve_timeout_per, false, NULL, &pages_reserved);
+  mi_atomic_add_acq_rel(&mi_huge_reserve_reserved, pages_reserved);
+  if (err != 0) {
+    mi_atomic_store_release(&mi_huge_reserve_err, (size_t)err);
+    mi_atomic_store_release(&mi_huge_reserve_pending, (size_t)0);  // stop at the first error
+  }
+  else {
+    mi_atomic_store_release(&mi_huge_reserve_pending, pending - 1);
+  }
+  if (mi_atomic_load_relaxed(&mi_huge_reserve_pending) == 0) {
+    _mi_verbose_message("asynchronous reservation of huge pages is done: %zu GiB reserved (of the %zu GiB requested)\n",
+                        mi_atomic_load_relaxed(&mi_huge_reserve_reserved), mi_huge_reserve_pages);
+  }
+  return true;
+}
+
+static int mi_reserve_huge_os_pages_async(size_t pages, size_t numa_first, size_t numa_count, size_t timeout_msecs) {
+  if (pages == 0) return 0;
+  if (numa_count == 0) numa_count = 1;
+  // claim the request state
+  size_t expected = 0;
+  if (!mi_atomic_cas_strong_acq_rel(&mi_huge_reserve_pending, &expected, SIZE_MAX)) return EBUSY;
+  mi_huge_reserve_pages = pages;
+  mi_huge_reserve_numa_first = numa_first;
+  mi_huge_reserve_numa_count = numa_count;
+  mi_huge_reserve_timeout_per = (timeout_msecs==0 ? 0 : (timeout_msecs / numa_count) + 50);
+  mi_atomic_store_relaxed(&mi_huge_reserve_reserved, (size_t)0);
+  mi_atomic_store_relaxed(&mi_huge_reserve_err, (size_t)0);
+  _mi_verbose_message("reserving %zu GiB huge pages asynchronously\n", pages);
+  mi_atomic_store_release(&mi_huge_reserve_pending, numa_count);
+  if (!mi_bgthread_ensure_started()) {
+    // no background thread available: reserve synchronously instead
+    while (mi_huge_reserve_async_step()) { };
+    return (int)mi_atomic_load_acquire(&mi_huge_reserve_err);
+  }
+  return 0;
+}
+
+// Start reserving huge pages evenly among the given number of numa nodes in the background.
+// Returns `EBUSY` if an asynchronous reservation is still in progress.
+int mi_reserve_huge_os_pages_interleave_async(size_t pages, size_t numa_nodes, size_t timeout_msecs) mi_attr_noexcept {
+  return mi_reserve_huge_os_pages_async(pages, 0, (numa_nodes > 0 ? numa_nodes : _mi_os_numa_node_count()), timeout_msecs);
+}
+
+// Start reserving huge pages at a specific numa node in the background.
+int mi_reserve_huge_os_pages_at_async(size_t pages, int numa_node, size_t timeout_msecs) mi_attr_noexcept {
+  return mi_reserve_huge_os_pages_async(pages, (numa_node < 0 ? 0 : (size_t)numa_node), 1, timeout_msecs);
+}
+
+// Is the asynchronous huge page reservation done? (also `true` if none was started)
+bool mi_reserve_huge_os_pages_async_is_done(size_t* pages_reserved, int* err) mi_attr_noexcept {
+  const bool done = (mi_atomic_load_acquire(&mi_huge_reserve_pending) == 0);
+  if (pages_reserved != NULL) { *pages_reserved = mi_atomic_load_acquire(&mi_huge_reserve_reserved); }
+  if (err != NULL) { *err = (done ? (int)mi_atomic_load_acquire(&mi_huge_reserve_err) : 0); }
+  return done;
+}
+
 int mi_reserve_huge_os_pages(size_t pages, double max_secs, size_t* pages_reserved) mi_attr_noexcept {
   MI_UNUSED(max_secs);
   _mi_warning_message("mi_reserve_huge_os_pages is deprecated: use mi_reserve_huge_os_pages_interleave/at instead\n");
@@ -439,3 +439,78 @@ bool _mi_bitmap_is_any_claimed_across(mi_bitmap_t bitmap, size_t bitmap_fields,
   mi_bitmap_is_claimedx_across(bitmap, bitmap_fields, count, bitmap_idx, &any_ones, NULL);
   return any_ones;
 }
+
+
+/* -----------------------------------------------------------
+  Summary bitmaps
+----------------------------------------------------------- */
+
+void _mi_bitmap_summary_init(mi_bitmap_t summary, size_t bitmap_fields) {
+  const size_t sfields = mi_bitmap_summary_fields(bitmap_fields);
+  for (size_t i = 0; i < sfields; i++) {
+    const size_t bits = (i + 1 < sfields ? MI_BITMAP_FIELD_BITS : bitmap_fields - (i * MI_BITMAP_FIELD_BITS));
+    mi_atomic_store_relaxed(&summary[i], mi_bitmap_mask_(bits, 0));
+  }
+}
+
+// Return the index of the first field in `[idx,end)` that may have zero bits (or `end` if there is none).
+static size_t mi_bitmap_summary_next(mi_bitmap_t summary, size_t idx, size_t end) {
+  while (idx < end) {
+    const size_t map = mi_atomic_load_relaxed(&summary[idx / MI_BITMAP_FIELD_BITS]) >> (idx % MI_BITMAP_FIELD_BITS);
+    if (map != 0) {
+      idx += mi_ctz(map);
+      return (idx < end ? idx : end);
+    }
+    idx = _mi_align_up(idx + 1, MI_BITMAP_FIELD_BITS);  // skip to the next summary field
+  }
+  return end;
+}
+
+// Clear the summary bit of field `idx` if that field is full.
+static void mi_bitmap_summary_update(mi_bitmap_t bitmap, mi_bitmap_t summary, size_t idx) {
+  if (mi_atomic_load_relaxed(&bitmap[idx]) != MI_BITMAP_FIELD_FULL) return;
+  const size_t mask = ((size_t)1 << (idx % MI_BITMAP_FIELD_BITS));
+  mi_atomic_and_acq_rel(&summary[idx / MI_BITMAP_FIELD_BITS], ~mask);
+  // a concurrent unclaim may have cleared bits in the field just before we cleared the summary bit.
+  // (as both update the summary with a read-modify-write, either the unclaim sets the bit after us, or we see its update here)
+  if (mi_atomic_load_acquire(&bitmap[idx]) != MI_BITMAP_FIELD_FULL) {
+    mi_atomic_or_acq_rel(&summary[idx / MI_BITMAP_FIELD_BITS], mask);
+  }
+}
+
+bool _mi_bitmap_try_find_from_claim_across_summary(mi_bitmap_t bitmap, mi_bitmap_t summary, const size_t bitmap_fields, const size_t start_field_idx, const size_t count, mi_bitmap_index_t* bitmap_idx) {
+  mi_assert_internal(count > 0);
+  const size_t start = (start_field_idx < bitmap_fields ? start_field_idx : 0);
+  // visit the fields from `start` to the end, and then wrap around
+  for (size_t pass = 0; pass < 2; pass++) {
+    const size_t end = (pass == 0 ? bitmap_fields : start);
+    size_t idx = (pass == 0 ? start : 0);
+    while ((idx = mi_bitmap_summary_next(summary, idx, end)) < end) {
+      // we don't bother with crossover fields for small counts
+      const bool found = (count <= 2 ? _mi_bitmap_try_find_claim_field(bitmap, idx, count, bitmap_idx)
+                                     : mi_bitmap_try_find_claim_field_across(bitmap, bitmap_fields, idx, count, 0, bitmap_idx));
+      if (found) {
+        // the claimed fields may be full now
+        const size_t last = mi_bitmap_index_field(*bitmap_idx + count - 1);
+        for (size_t i = mi_bitmap_index_field(*bitmap_idx); i <= last; i++) {
+          mi_bitmap_summary_update(bitmap, summary, i);
+        }
+        return true;
+      }
+      // lazily clear the summary bit for fields that were filled (for example by `_mi_bitmap_claim_across`)
+      mi_bitmap_summary_update(bitmap, summary, idx);
+      idx++;
+    }
+  }
+  return false;
+}
+
+bool _mi_bitmap_unclaim_across_summary(mi_bitmap_t bitmap, mi_bitmap_t summary, size_t bitmap_fields, size_t count, mi_bitmap_index_t bitmap_idx) {
+  const bool all_one = _mi_bitmap_unclaim_across(bitmap, bitmap_fields, count, bitmap_idx);
+  // always use a read-modify-write (see `mi_bitmap_summary_update`)
+  const size_t last = mi_bitmap_index_field(bitmap_idx + count - 1);
+  for (size_t i = mi_bitmap_index_field(bitmap_idx); i <= last; i++) {
+    mi_atomic_or_acq_rel(&summary[i / MI_BITMAP_FIELD_BITS], ((size_t)1 << (i % MI_BITMAP_FIELD_BITS)));
+  }
+  return all_one;
+}
@@ -116,4 +116,28 @@ bool _mi_bitmap_claim_across(mi_bitmap_t bitmap, size_t bitmap_fields, size_t co
 bool _mi_bitmap_is_claimed_across(mi_bitmap_t bitmap, size_t bitmap_fields, size_t count, mi_bitmap_index_t bitmap_idx, size_t* already_set);
 bool _mi_bitmap_is_any_claimed_across(mi_bitmap_t bitmap, size_t bitmap_fields, size_t count, mi_bitmap_index_t bitmap_idx);
 
+
+//--------------------------------------------------------------------------
+// A summary bitmap has one bit per field of a bitmap that is set if that
+// field may have zero bits (and is clear if the field is known to be full).
+// It is a conservative hint: a field with zero bits always has its summary
+// bit set, so searches can skip full fields a summary word at a time.
+// This is used for the in-use bitmap of (large) arena's.
+//--------------------------------------------------------------------------
+
+// The number of summary fields needed for a bitmap of `bitmap_fields` fields.
+static inline size_t mi_bitmap_summary_fields(size_t bitmap_fields) {
+  return (bitmap_fields + MI_BITMAP_FIELD_BITS - 1) / MI_BITMAP_FIELD_BITS;
+}
+
+// Initialize a `summary` to mark all `bitmap_fields` as possibly having zero bits.
+void _mi_bitmap_summary_init(mi_bitmap_t summary, size_t bitmap_fields);
+
+// Like `_mi_bitmap_try_find_from_claim_across` but only visits fields that may have zero bits
+// according to the `summary` (and updates the summary for fields that are found to be full).
+bool _mi_bitmap_try_find_from_claim_across_summary(mi_bitmap_t bitmap, mi_bitmap_t summary, const size_t bitmap_fields, const size_t start_field_idx, const size_t count, mi_bitmap_index_t* bitmap_idx);
+
+// Like `_mi_bitmap_unclaim_across` but also marks the fields in the `summary` as having zero bits.
+bool _mi_bitmap_unclaim_across_summary(mi_bitmap_t bitmap, mi_bitmap_t summary, size_t bitmap_fields, size_t count, mi_bitmap_index_t bitmap_idx);
+
 #endif
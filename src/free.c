@@ -25,6 +25,7 @@ static void   mi_stat_free(const mi_page_t* page, const mi_block_t* block);
 
 // forward declaration of multi-threaded free (`_mt`) (or free in huge block if compiled with MI_HUGE_PAGE_ABANDON)
 static mi_decl_noinline void mi_free_block_mt(mi_page_t* page, mi_segment_t* segment, mi_block_t* block);
+static bool mi_remote_free_buffer_push(mi_page_t* page, mi_block_t* block);
 
 // regular free of a (thread local) block pointer
 // fast path written carefully to prevent spilling on the stack
@@ -83,18 +84,33 @@ static inline void mi_block_check_unguard(mi_page_t* page, mi_block_t* block, vo
 }
 #endif
 
+// remove a block that was sampled by the heap profiler (pages with sampled blocks always use the generic free path)
+#if MI_PROFILE
+static inline void mi_block_check_unsample(mi_page_t* page, mi_block_t* block) {
+  if mi_unlikely(mi_page_has_sampled(page)) { _mi_profile_free(block); }
+}
+#else
+static inline void mi_block_check_unsample(mi_page_t* page, mi_block_t* block) {
+  MI_UNUSED(page); MI_UNUSED(block);
+}
+#endif
+
 // free a local pointer  (page parameter comes first for better codegen)
 static void mi_decl_noinline mi_free_generic_local(mi_page_t* page, mi_segment_t* segment, void* p) mi_attr_noexcept {
   MI_UNUSED(segment);
+  if mi_unlikely(mi_page_is_monotonic(page)) return;  // blocks in a monotonic heap are only released by `mi_heap_destroy`
   mi_block_t* const block = (mi_page_has_aligned(page) ? _mi_page_ptr_unalign(page, p) : (mi_block_t*)p);
   mi_block_check_unguard(page, block, p);
+  mi_block_check_unsample(page, block);
   mi_free_block_local(page, block, true /* track stats */, true /* check for a full page */);
 }
 
 // free a pointer owned by another thread (page parameter comes first for better codegen)
 static void mi_decl_noinline mi_free_generic_mt(mi_page_t* page, mi_segment_t* segment, void* p) mi_attr_noexcept {
+  if mi_unlikely(mi_page_is_monotonic(page)) return;  // blocks in a monotonic heap are only released by `mi_heap_destroy`
   mi_block_t* const block = _mi_page_ptr_unalign(page, p); // don't check `has_aligned` flag to avoid a race (issue #865)
   mi_block_check_unguard(page, block, p);
+  mi_block_check_unsample(page, block);
   mi_free_block_mt(page, segment, block);
 }
 
@@ -157,7 +173,7 @@ void mi_free(void* p) mi_attr_noexcept
   mi_page_t* const page = _mi_segment_page_of(segment, p);
 
   if mi_likely(is_local) {                        // thread-local free?
-    if mi_likely(page->flags.full_aligned == 0) { // and it is not a full page (full pages need to move from the full bin), nor has aligned blocks (aligned blocks need to be unaligned)
+    if mi_likely(page->flags.full_aligned == 0) { // and it is not a full page (full pages need to move from the full bin), nor has aligned blocks (aligned blocks need to be unaligned), nor is monotonic
       // thread-local, aligned, and not a full page
       mi_block_t* const block = (mi_block_t*)p;
       mi_free_block_local(page, block, true /* track stats */, false /* no need to check if the page is full */);
@@ -300,10 +316,199 @@ static void mi_decl_noinline mi_free_block_mt(mi_page_t* page, mi_segment_t* seg
 
   // and finally free the actual block by pushing it on the owning heap
   // thread_delayed free list (or heap delayed free list)
+  if (segment->kind != MI_SEGMENT_HUGE && mi_remote_free_buffer_push(page, block)) {
+    return;  // buffered and published later
+  }
   mi_free_block_delayed_mt(page,block);
 }
 
 
+// ------------------------------------------------------
+// Batch free
+// ------------------------------------------------------
+
+// Push a chain of blocks `first` to `last` (linked through the page keys) that are
+// owned by another thread on the page thread free list with a single CAS.
+static void mi_decl_noinline mi_free_block_chain_delayed_mt(mi_page_t* page, mi_block_t* first, mi_block_t* last)
+{
+  mi_thread_free_t tfreex;
+  mi_thread_free_t tfree = mi_atomic_load_relaxed(&page->xthread_free);
+  do {
+    if mi_unlikely(mi_tf_delayed(tfree) == MI_USE_DELAYED_FREE) {
+      // unlikely: the page is in the full list; push the first block through the regular
+      // path so the owning heap is notified, and then the rest of the chain
+      mi_block_t* const next = (first == last ? NULL : mi_block_next(page, first));
+      mi_free_block_delayed_mt(page, first);
+      if (next != NULL) { mi_free_block_chain_delayed_mt(page, next, last); }
+      return;
+    }
+    mi_block_set_next(page, last, mi_tf_block(tfree));
+    tfreex = mi_tf_set_block(tfree, first);
+  } while (!mi_atomic_cas_weak_release(&page->xthread_free, &tfree, tfreex));
+}
+
+// Free a run of pointers that all point into the same `page`. The blocks are linked into one chain
+// and either spliced onto the local free list (if the page is thread local), or pushed on
+// the thread free list of the page with a single CAS.
+static void mi_free_batch_page(mi_page_t* page, bool is_local, void** ptrs, size_t count)
+{
+  if mi_unlikely(mi_page_is_monotonic(page)) return;  // blocks in a monotonic heap are only released by `mi_heap_destroy`
+  mi_block_t* first = NULL;
+  mi_block_t* last  = NULL;
+  size_t freed = 0;
+  for (size_t i = 0; i < count; i++) {
+    void* const p = ptrs[i];
+    if mi_unlikely(i > 0 && p == ptrs[i-1]) {  // pointers are sorted so duplicates are adjacent
+      _mi_error_message(EAGAIN, "double free detected of block %p in a batch\n", p);
+      continue;
+    }
+    // don't check the `has_aligned` flag for non-local pages to avoid a race (issue #865)
+    mi_block_t* const block = (!is_local || mi_page_has_aligned(page) ? _mi_page_ptr_unalign(page, p) : (mi_block_t*)p);
+    mi_block_check_unguard(page, block, p);
+    if (is_local && mi_check_is_double_free(page, block)) continue;
+    mi_block_check_unsample(page, block);
+    mi_check_padding(page, block);
+    mi_stat_free(page, block);
+    mi_track_free_size(block, mi_page_usable_size_of(page, block));
+    if (!is_local) {
+      _mi_padding_shrink(page, block, sizeof(mi_block_t));
+    }
+    #if (MI_DEBUG>0) && !MI_TRACK_ENABLED && !MI_TSAN && !MI_GUARDED
+    memset(block, MI_DEBUG_FREED, (is_local ? mi_page_block_size(page) : mi_usable_size(block)));
+    #endif
+    // link in front of the chain
+    mi_block_set_next(page, block, first);
+    if (last == NULL) { last = block; }
+    first = block;
+    freed++;
+  }
+  if (first == NULL) return;
+
+  if (is_local) {
+    // splice the chain onto the local free list
+    mi_block_set_next(page, last, page->local_free);
+    page->local_free = first;
+    mi_assert_internal(page->used >= freed);
+    page->used -= (uint16_t)freed;
+    if (page->used == 0) {
+      _mi_page_retire(page);
+    }
+    else if (mi_page_is_in_full(page)) {
+      _mi_page_unfull(page);
+    }
+  }
+  else {
+    mi_free_block_chain_delayed_mt(page, first, last);
+  }
+}
+
+
+// ------------------------------------------------------
+// Remote free buffering
+// When `mi_option_remote_free_buffer` is N > 1, blocks freed into a page that is
+// owned by another thread are buffered per page (in a few slots in the thread
+// local data) and pushed as one chain after N frees. This reduces contention on
+// the `xthread_free` field of pages that are freed into by many threads.
+// The buffers are also flushed on `mi_collect` and when the thread terminates.
+// ------------------------------------------------------
+
+static void mi_remote_free_flush_slot(mi_remote_free_t* rf) {
+  if (rf->page == NULL) return;
+  mi_assert_internal(rf->first != NULL && rf->last != NULL && rf->count > 0);
+  mi_free_block_chain_delayed_mt(rf->page, rf->first, rf->last);
+  rf->page  = NULL;
+  rf->first = NULL;
+  rf->last  = NULL;
+  rf->count = 0;
+}
+
+// Publish all buffered frees of this thread
+void _mi_remote_free_flush(mi_tld_t* tld) {
+  if (tld == NULL) return;
+  for (size_t i = 0; i < MI_REMOTE_FREE_SLOTS; i++) {
+    mi_remote_free_flush_slot(&tld->remote_free[i]);
+  }
+}
+
+// Try to buffer a non-local free; returns `false` if buffering is disabled.
+static bool mi_remote_free_buffer_push(mi_page_t* page, mi_block_t* block) {
+  const long max = _mi_option_get_fast(mi_option_remote_free_buffer);
+  if mi_likely(max <= 1) return false;
+  mi_heap_t* const heap = mi_prim_get_default_heap();
+  if (!mi_heap_is_initialized(heap)) return false;  // the thread is terminating
+  const uintptr_t hash = ((uintptr_t)page / sizeof(mi_page_t)) ^ ((uintptr_t)page >> MI_SEGMENT_SHIFT);
+  mi_remote_free_t* const rf = &heap->tld->remote_free[hash % MI_REMOTE_FREE_SLOTS];
+  if (rf->page != page) {
+    // slot is in use by another page: publish those first
+    mi_remote_free_flush_slot(rf);
+    rf->page = page;
+  }
+  mi_block_set_next(page, block, rf->first);
+  if (rf->last == NULL) { rf->last = block; }
+  rf->first = block;
+  rf->count++;
+  if (rf->count >= (size_t)max) {
+    mi_remote_free_flush_slot(rf);
+  }
+  return true;
+}
+
+
+// sort pointers in place by address (using heap sort as we cannot allocate here)
+static void mi_ptrs_sift_down(void** ptrs, size_t root, size_t n) {
+  while (2*root + 1 < n) {
+    size_t child = 2*root + 1;
+    if (child + 1 < n && (uintptr_t)ptrs[child] < (uintptr_t)ptrs[child+1]) { child++; }
+    if ((uintptr_t)ptrs[root] >= (uintptr_t)ptrs[child]) return;
+    void* const t = ptrs[root]; ptrs[root] = ptrs[child]; ptrs[child] = t;
+    root = child;
+  }
+}
+
+static void mi_ptrs_sort(void** ptrs, size_t n) {
+  if (n < 2) return;
+  for (size_t i = n/2; i > 0; i--) {
+    mi_ptrs_sift_down(ptrs, i-1, n);
+  }
+  for (size_t end = n-1; end > 0; end--) {
+    void* const t = ptrs[0]; ptrs[0] = ptrs[end]; ptrs[end] = t;
+    mi_ptrs_sift_down(ptrs, 0, end);
+  }
+}
+
+// Free `n` pointers at once. The pointers are sorted in place (so the contents of `ptrs` are
+// reordered) to group them by page; each page is then checked once and its blocks are freed in one step.
+void mi_free_batch(void** ptrs, size_t n) mi_attr_noexcept
+{
+  if (ptrs == NULL || n == 0) return;
+  mi_ptrs_sort(ptrs, n);
+  size_t i = 0;
+  while (i < n) {
+    void* const p = ptrs[i];
+    if (p == NULL) { i++; continue; }
+    mi_segment_t* const segment = mi_checked_ptr_segment(p, "mi_free_batch");
+    if mi_unlikely(segment == NULL) { i++; continue; }
+    mi_page_t* const page = _mi_segment_page_of(segment, p);
+
+    // find the run of pointers in the same page
+    size_t j = i + 1;
+    while (j < n && _mi_ptr_segment(ptrs[j]) == segment && _mi_segment_page_of(segment, ptrs[j]) == page) {
+      j++;
+    }
+
+    const uintptr_t tid = mi_atomic_load_relaxed(&segment->thread_id);
+    if (j - i == 1 || tid == 0 || segment->kind == MI_SEGMENT_HUGE) {
+      // single pointers, abandoned segments (that may be reclaimed), and huge pages use the regular path
+      for (size_t k = i; k < j; k++) { mi_free(ptrs[k]); }
+    }
+    else {
+      mi_free_batch_page(page, tid == _mi_prim_thread_id(), &ptrs[i], j - i);
+    }
+    i = j;
+  }
+}
+
+
 // ------------------------------------------------------
 // Usable size
 // ------------------------------------------------------
@@ -53,21 +53,23 @@ static bool mi_heap_visit_pages(mi_heap_t* heap, heap_page_visitor_fun* fn, void
 
 
 #if MI_DEBUG>=2
-static bool mi_heap_page_is_valid(mi_heap_t* heap, mi_page_queue_t* pq, mi_page_t* page, void* arg1, void* arg2) {
-  MI_UNUSED(arg1);
+static bool mi_heap_page_is_valid(mi_heap_t* heap, mi_page_queue_t* pq, mi_page_t* page, void* vbytes, void* arg2) {
   MI_UNUSED(arg2);
   MI_UNUSED(pq);
   mi_assert_internal(mi_page_heap(page) == heap);
   mi_segment_t* segment = _mi_page_segment(page);
   mi_assert_internal(mi_atomic_load_relaxed(&segment->thread_id) == heap->thread_id);
   mi_assert_expensive(_mi_page_is_valid(page));
+  if (vbytes != NULL) { *((size_t*)vbytes) += mi_page_slices_size(page); }
   return true;
 }
 #endif
 #if MI_DEBUG>=3
 static bool mi_heap_is_valid(mi_heap_t* heap) {
   mi_assert_internal(heap!=NULL);
-  mi_heap_visit_pages(heap, &mi_heap_page_is_valid, NULL, NULL);
+  size_t page_bytes = 0;
+  mi_heap_visit_pages(heap, &mi_heap_page_is_valid, &page_bytes, NULL);
+  mi_assert_internal(page_bytes == heap->page_bytes);
   return true;
 }
 #endif
@@ -131,6 +133,11 @@ static void mi_heap_collect_ex(mi_heap_t* heap, mi_collect_t collect)
   // python/cpython#112532: we may be called from a thread that is not the owner of the heap
   const bool is_main_thread = (_mi_is_main_thread() && heap->thread_id == _mi_thread_id());
 
+  // publish any buffered non-local frees of this thread
+  if (heap->thread_id == _mi_thread_id()) {
+    _mi_remote_free_flush(heap->tld);
+  }
+
   // note: never reclaim on collect but leave it to threads that need storage to reclaim
   const bool force_main =
     #ifdef NDEBUG
@@ -165,18 +172,22 @@ static void mi_heap_collect_ex(mi_heap_t* heap, mi_collect_t collect)
 
   // collect abandoned segments (in particular, purge expired parts of segments in the abandoned segment list)
   // note: forced purge can be quite expensive if many threads are created/destroyed so we do not force on abandonment
-  _mi_abandoned_collect(heap, collect == MI_FORCE /* force? */, &heap->tld->segments);
+  // note: if there is a background purge thread, it collects the abandoned segments unless forced
+  if (collect == MI_FORCE || !_mi_purge_thread_is_active()) {
+    _mi_abandoned_collect(heap, collect == MI_FORCE /* force? */, &heap->tld->segments);
+  }
 
   // if forced, collect thread data cache on program-exit (or shared library unload)
   if (force && is_main_thread && mi_heap_is_backing(heap)) {
+    _mi_heap_recycle_collect();  // abandon parked heaps of exited threads
     _mi_thread_data_collect();  // collect thread data cache
   }
 
   // collect arenas (this is program wide so don't force purges on abandonment of threads)
   _mi_arenas_collect(collect == MI_FORCE /* force purge? */);
 
-  // merge statistics
-  if (collect <= MI_FORCE) {
+  // merge statistics (but not in an exiting thread as that would initialize a fresh heap)
+  if (collect <= MI_FORCE && mi_heap_is_initialized(mi_prim_get_default_heap())) {
     mi_stats_merge();
   }
 }
@@ -185,6 +196,24 @@ void _mi_heap_collect_abandon(mi_heap_t* heap) {
   mi_heap_collect_ex(heap, MI_ABANDON);
 }
 
+static mi_decl_noinline bool mi_heap_page_set_owner(mi_heap_t* heap, mi_page_queue_t* pq, mi_page_t* page, void* arg1, void* arg2) {
+  MI_UNUSED(heap); MI_UNUSED(pq); MI_UNUSED(arg2);
+  mi_segment_t* const segment = _mi_page_segment(page);
+  #if MI_HUGE_PAGE_ABANDON
+  if (segment->kind == MI_SEGMENT_HUGE) return true;  // huge segments are always abandoned
+  #endif
+  mi_atomic_store_release(&segment->thread_id, *((mi_threadid_t*)arg1));
+  return true;
+}
+
+// Transfer a backing heap with all its segments to the thread `tid` (or to no thread if `tid` is 0).
+// Used to park the heap of an exiting thread and to adopt it in a new thread.
+void _mi_heap_set_owner(mi_heap_t* heap, mi_threadid_t tid) {
+  mi_assert_internal(mi_heap_is_backing(heap) && heap->tld->heaps == heap && heap->next == NULL);
+  heap->thread_id = tid;
+  mi_heap_visit_pages(heap, &mi_heap_page_set_owner, &tid, NULL);
+}
+
 void mi_heap_collect(mi_heap_t* heap, bool force) mi_attr_noexcept {
   mi_heap_collect_ex(heap, (force ? MI_FORCE : MI_NORMAL));
 }
@@ -219,6 +248,7 @@ mi_heap_t* mi_heap_get_backing(void) {
 
 void _mi_heap_init(mi_heap_t* heap, mi_tld_t* tld, mi_arena_id_t arena_id, bool noreclaim, uint8_t tag) {
   _mi_memcpy_aligned(heap, &_mi_heap_empty, sizeof(mi_heap_t));
+  _mi_heap_init_queues(heap);
   heap->tld = tld;
   heap->thread_id  = _mi_thread_id();
   heap->arena_id   = arena_id;
@@ -234,6 +264,7 @@ void _mi_heap_init(mi_heap_t* heap, mi_tld_t* tld, mi_arena_id_t arena_id, bool
   heap->keys[0] = _mi_heap_random_next(heap);
   heap->keys[1] = _mi_heap_random_next(heap);
   _mi_heap_guarded_init(heap);
+  _mi_heap_profile_init(heap);
   // push on the thread local heaps list
   heap->next = heap->tld->heaps;
   heap->tld->heaps = heap;
@@ -257,6 +288,32 @@ mi_decl_nodiscard mi_heap_t* mi_heap_new(void) {
   return mi_heap_new_ex(0 /* default heap tag */, true /* no reclaim */, _mi_arena_id_none());
 }
 
+void mi_heap_set_limit(mi_heap_t* heap, size_t limit, mi_heap_limit_fun* fun, void* arg) {
+  if (heap==NULL || !mi_heap_is_initialized(heap)) return;
+  heap->page_bytes_limit = limit;
+  heap->limit_fun = fun;
+  heap->limit_arg = arg;
+}
+
+size_t mi_heap_get_reserved(mi_heap_t* heap) {
+  if (heap==NULL || !mi_heap_is_initialized(heap)) return 0;
+  return heap->page_bytes;
+}
+
+mi_decl_nodiscard mi_heap_t* mi_heap_new_monotonic(void) {
+  mi_heap_t* heap = mi_heap_new_ex(0 /* default heap tag */, true /* allow destroy */, _mi_arena_id_none());
+  if (heap != NULL) { heap->monotonic = true; }
+  return heap;
+}
+
+mi_decl_nodiscard mi_heap_t* mi_heap_new_on_node(int numa_node) {
+  mi_heap_t* heap = mi_heap_new_ex(0 /* default heap tag */, false /* don't allow `mi_heap_destroy` (so it can reclaim) */, _mi_arena_id_none());
+  if (heap != NULL && numa_node >= 0) {
+    heap->numa_node = numa_node % (int)_mi_os_numa_node_count();
+  }
+  return heap;
+}
+
 bool _mi_heap_memid_is_suitable(mi_heap_t* heap, mi_memid_t memid) {
   return _mi_arena_memid_is_suitable(memid, heap->arena_id);
 }
@@ -272,8 +329,10 @@ static void mi_heap_reset_pages(mi_heap_t* heap) {
   // TODO: copy full empty heap instead?
   memset(&heap->pages_free_direct, 0, sizeof(heap->pages_free_direct));
   _mi_memcpy_aligned(&heap->pages, &_mi_heap_empty.pages, sizeof(heap->pages));
+  _mi_heap_init_queues(heap);
   heap->thread_delayed_free = NULL;
   heap->page_count = 0;
+  heap->page_bytes = 0;
 }
 
 // called from `mi_heap_destroy` and `mi_heap_delete` to free the internal heap resources.
@@ -356,6 +415,14 @@ static bool _mi_heap_page_destroy(mi_heap_t* heap, mi_page_queue_t* pq, mi_page_
   // mi_heap_stat_decrease(heap, malloc_requested, bsize * inuse);  // todo: off for aligned blocks...
   #endif
 
+  #if MI_PROFILE
+  // forget the sampled blocks in this page
+  if (mi_page_has_sampled(page)) {
+    _mi_profile_free_range(mi_page_start(page), page->reserved * bsize);
+    mi_page_set_has_sampled(page, false);
+  }
+  #endif
+
   /// pretend it is all free now
   mi_assert_internal(mi_page_thread_free(page) == NULL);
   page->used = 0;
@@ -451,6 +518,8 @@ static void mi_heap_absorb(mi_heap_t* heap, mi_heap_t* from) {
     from->page_count -= pcount;
   }
   mi_assert_internal(from->page_count == 0);
+  heap->page_bytes += from->page_bytes;
+  from->page_bytes = 0;
 
   // and do outstanding delayed frees in the `from` heap
   // note: be careful here as the `heap` field in all those pages no longer point to `from`,
@@ -472,6 +541,12 @@ static bool mi_heaps_are_compatible(mi_heap_t* heap1, mi_heap_t* heap2) {
 }
 
 // Safe delete a heap without freeing any still allocated blocks in that heap.
+static bool mi_heap_page_unset_monotonic(mi_heap_t* heap, mi_page_queue_t* pq, mi_page_t* page, void* arg1, void* arg2) {
+  MI_UNUSED(heap); MI_UNUSED(pq); MI_UNUSED(arg1); MI_UNUSED(arg2);
+  mi_page_set_monotonic(page, false);
+  return true;
+}
+
 void mi_heap_delete(mi_heap_t* heap)
 {
   mi_assert(heap != NULL);
@@ -479,6 +554,13 @@ void mi_heap_delete(mi_heap_t* heap)
   mi_assert_expensive(mi_heap_is_valid(heap));
   if (heap==NULL || !mi_heap_is_initialized(heap)) return;
 
+  if (heap->monotonic) {
+    // pages that are transferred or abandoned become regular pages again
+    // (note: blocks that were freed while the heap was monotonic stay in use)
+    mi_heap_visit_pages(heap, &mi_heap_page_unset_monotonic, NULL, NULL);
+    heap->monotonic = false;
+  }
+
   mi_heap_t* bheap = heap->tld->heap_backing;
   if (bheap != heap && mi_heaps_are_compatible(bheap,heap)) {
     // transfer still used pages to the backing heap
@@ -549,6 +631,173 @@ bool mi_check_owned(const void* p) {
   return mi_heap_check_owned(mi_prim_get_default_heap(), p);
 }
 
+/* -----------------------------------------------------------
+  Fragmentation per size bin
+----------------------------------------------------------- */
+
+static bool mi_heap_page_frag_add(mi_heap_t* heap, mi_page_queue_t* pq, mi_page_t* page, void* vinfo, void* arg2) {
+  MI_UNUSED(heap); MI_UNUSED(pq); MI_UNUSED(arg2);
+  mi_frag_info_t* info = (mi_frag_info_t*)vinfo;
+  const size_t bsize = mi_page_block_size(page);
+  mi_frag_bin_t* bin = &info->bins[_mi_bin(bsize)];
+  const size_t committed = page->capacity * bsize;
+  const size_t used = page->used * bsize;
+  bin->page_count++;
+  bin->reserved  += page->reserved;
+  bin->capacity  += page->capacity;
+  bin->used      += page->used;
+  bin->committed += committed;
+  bin->wasted    += (committed > used ? committed - used : 0);
+  return true;
+}
+
+static void mi_frag_info_init(mi_frag_info_t* info) {
+  _mi_memzero_var(*info);
+  for (size_t i = 0; i <= MI_BIN_HUGE; i++) {
+    info->bins[i].block_size = _mi_bin_size(i);
+  }
+}
+
+void mi_heap_fragmentation_get(mi_heap_t* heap, mi_frag_info_t* info) mi_attr_noexcept {
+  if (info == NULL) return;
+  mi_frag_info_init(info);
+  if (heap == NULL || !mi_heap_is_initialized(heap)) return;
+  mi_heap_visit_pages(heap, &mi_heap_page_frag_add, info, NULL);
+}
+
+void mi_fragmentation_get(mi_frag_info_t* info) mi_attr_noexcept {
+  if (info == NULL) return;
+  mi_frag_info_init(info);
+  mi_heap_t* heap = mi_prim_get_default_heap();
+  if (heap == NULL || !mi_heap_is_initialized(heap)) return;
+  for (mi_heap_t* h = heap->tld->heaps; h != NULL; h = h->next) {
+    mi_heap_visit_pages(h, &mi_heap_page_frag_add, info, NULL);
+  }
+}
+
+
+/* -----------------------------------------------------------
+  Defragmentation: move live blocks out of sparsely used pages
+  through a user callback so those pages can be freed.
+----------------------------------------------------------- */
+
+// Is a page used below `ratio` of its blocks (and not the page we currently allocate from)?
+static bool mi_heap_page_is_sparse(mi_heap_t* heap, const mi_page_t* page, double ratio) {
+  if (page->reserved <= 1 || page->used == 0) return false;  // single block pages cannot be compacted
+  if (!mi_page_is_in_full(page) && mi_page_queue(heap, mi_page_block_size(page))->first == page) return false;
+  return ((double)page->used < ratio * (double)page->reserved);
+}
+
+bool mi_heap_page_is_underutilized(mi_heap_t* heap, const void* p, double ratio) {
+  if (heap==NULL || !mi_heap_is_initialized(heap) || p==NULL) return false;
+  if (!mi_is_in_heap_region(p)) return false;  // only dereference the segment of pointers in mimalloc memory
+  const mi_page_t* page = _mi_ptr_page((void*)p);
+  if (mi_page_heap(page) != heap) return false;
+  return mi_heap_page_is_sparse(heap, page, ratio);
+}
+
+typedef struct mi_defrag_pages_s {
+  double      ratio;
+  size_t      count;
+  size_t      capacity;
+  mi_page_t** pages;    // NULL when just counting
+} mi_defrag_pages_t;
+
+// Count the sparse pages, or record and pin them (by incrementing `used`) so they stay alive while moving blocks
+static bool mi_heap_page_defrag_select(mi_heap_t* heap, mi_page_queue_t* pq, mi_page_t* page, void* vdp, void* arg2) {
+  MI_UNUSED(pq); MI_UNUSED(arg2);
+  mi_defrag_pages_t* dp = (mi_defrag_pages_t*)vdp;
+  if (!mi_heap_page_is_sparse(heap, page, dp->ratio)) return true;
+  if (dp->pages != NULL) {
+    if (dp->count >= dp->capacity) return false;
+    page->used++;
+    dp->pages[dp->count] = page;
+  }
+  dp->count++;
+  return true;
+}
+
+#define MI_DEFRAG_BATCH  (64)
+
+typedef struct mi_defrag_blocks_s {
+  uint8_t* after;       // only collect blocks after this address
+  size_t   count;
+  void*    blocks[MI_DEFRAG_BATCH];
+} mi_defrag_blocks_t;
+
+static bool mi_cdecl mi_heap_defrag_collect_block(const mi_heap_t* heap, const mi_heap_area_t* area, void* block, size_t block_size, void* vdb) {
+  MI_UNUSED(heap); MI_UNUSED(area); MI_UNUSED(block_size);
+  mi_defrag_blocks_t* db = (mi_defrag_blocks_t*)vdb;
+  if ((uint8_t*)block <= db->after) return true;
+  db->blocks[db->count++] = block;
+  return (db->count < MI_DEFRAG_BATCH);
+}
+
+// Move all live blocks out of a pinned page; returns `false` if the `move` function stopped the defragmentation.
+static bool mi_heap_defrag_page(mi_heap_t* heap, mi_page_t* page, mi_block_move_fun* move, void* arg) {
+  const size_t ubsize = mi_page_usable_block_size(page);
+  mi_defrag_blocks_t db;
+  db.after = NULL;
+  do {
+    // collect the next batch of live blocks (in address order) with the page temporarily unpinned
+    mi_heap_area_t area;
+    _mi_heap_area_init(&area, page);
+    db.count = 0;
+    page->used--;
+    _mi_heap_area_visit_blocks(&area, page, &mi_heap_defrag_collect_block, &db);
+    page->used++;
+    // and move them; the pin keeps the page alive even when all its blocks are freed
+    for (size_t i = 0; i < db.count; i++) {
+      if (!move(heap, db.blocks[i], ubsize, arg)) return false;
+    }
+    if (db.count > 0) { db.after = (uint8_t*)db.blocks[db.count - 1]; }
+  } while (db.count == MI_DEFRAG_BATCH);
+  return true;
+}
+
+size_t mi_heap_defrag(mi_heap_t* heap, double ratio, mi_block_move_fun* move, void* arg) {
+  if (heap==NULL || !mi_heap_is_initialized(heap) || move==NULL || !(ratio > 0.0)) return 0;
+  mi_assert(heap->thread_id == _mi_thread_id());
+  mi_heap_collect(heap, false);  // free empty pages and collect the free lists for accurate usage counts
+
+  // select and pin the sparse pages
+  mi_defrag_pages_t dp = { ratio, 0, 0, NULL };
+  mi_heap_visit_pages(heap, &mi_heap_page_defrag_select, &dp, NULL);
+  if (dp.count == 0) return 0;
+  dp.pages = (mi_page_t**)mi_heap_malloc(heap->tld->heap_backing, dp.count * sizeof(mi_page_t*));
+  if (dp.pages == NULL) return 0;
+  dp.capacity = dp.count;
+  dp.count = 0;
+  mi_heap_visit_pages(heap, &mi_heap_page_defrag_select, &dp, NULL);
+
+  // take them out of their queues so the moved blocks are allocated in other pages
+  for (size_t i = 0; i < dp.count; i++) {
+    _mi_page_queue_unlink(dp.pages[i]);
+  }
+
+  // move the live blocks out of the sparse pages
+  for (size_t i = 0; i < dp.count; i++) {
+    if (!mi_heap_defrag_page(heap, dp.pages[i], move, arg)) break;
+  }
+
+  // unpin and relink, and free the pages that are now empty
+  size_t freed = 0;
+  for (size_t i = 0; i < dp.count; i++) {
+    mi_page_t* page = dp.pages[i];
+    page->used--;
+    mi_page_queue_t* const pq = _mi_page_queue_relink(page);
+    _mi_page_free_collect(page, false);
+    if (mi_page_all_free(page)) {
+      mi_assert_internal(!mi_page_is_in_full(page));
+      _mi_page_free(page, pq, false);
+      freed++;
+    }
+  }
+  mi_free(dp.pages);
+  return freed;
+}
+
+
 /* -----------------------------------------------------------
   Visit all heap blocks and areas
   Todo: enable visiting abandoned pages, and
@@ -80,8 +80,9 @@ const mi_page_t _mi_page_empty = {
   { 0 }, { 0 }, { 0 }, { 0 }, { 0 }, \
   MI_INIT4(MI_STAT_COUNT_NULL), \
   { 0 }, { 0 }, { 0 }, { 0 },  \
+  MI_STAT_COUNT_NULL(), MI_STAT_COUNT_NULL(), \
   \
-  { MI_INIT4(MI_STAT_COUNT_NULL) }, \
+  { MI_STAT_COUNT_NULL(), MI_STAT_COUNT_NULL() }, \
   { { 0 }, { 0 }, { 0 }, { 0 } }, \
   \
   { MI_INIT74(MI_STAT_COUNT_NULL) }, \
@@ -114,17 +115,24 @@ mi_decl_cache_align const mi_heap_t _mi_heap_empty = {
   0,                // tid
   0,                // cookie
   0,                // arena id
+  -1,               // numa node
   { 0, 0 },         // keys
   { {0}, {0}, 0, true }, // random
   0,                // page count
+  0, 0,             // page bytes and limit
+  NULL, NULL,       // limit function and argument
   MI_BIN_FULL, 0,   // page retired min/max
   0, 0,             // generic count
   NULL,             // next
   false,            // can reclaim
+  false,            // monotonic
   0,                // tag
   #if MI_GUARDED
   0, 0, 0, 0, 1,    // count is 1 so we never write to it (see `internal.h:mi_heap_malloc_use_guarded`)
   #endif
+  #if MI_PROFILE
+  0, 0,             // rate and count are 0 so we never write to it (see `internal.h:mi_heap_profile_sample`)
+  #endif
   MI_SMALL_PAGES_EMPTY,
   MI_PAGE_QUEUES_EMPTY
 };
@@ -137,8 +145,9 @@ mi_decl_cache_align static const mi_tld_t tld_empty = {
   0,
   false,
   NULL, NULL,
-  { MI_SEGMENT_SPAN_QUEUES_EMPTY, 0, 0, 0, 0, 0, &mi_subproc_default, tld_empty_stats }, // segments
-  { MI_STAT_VERSION, MI_STATS_NULL }       // stats
+  { MI_SEGMENT_SPAN_QUEUES_EMPTY, 0, 0, 0, 0, 0, 0, &mi_subproc_default, tld_empty_stats }, // segments
+  { MI_STAT_VERSION, MI_STATS_NULL },      // stats
+  { { NULL, NULL, NULL, 0 } }              // remote free
 };
 
 mi_threadid_t _mi_thread_id(void) mi_attr_noexcept {
@@ -153,8 +162,9 @@ extern mi_decl_hidden mi_heap_t _mi_heap_main;
 static mi_decl_cache_align mi_tld_t tld_main = {
   0, false,
   &_mi_heap_main, & _mi_heap_main,
-  { MI_SEGMENT_SPAN_QUEUES_EMPTY, 0, 0, 0, 0, 0, &mi_subproc_default, &tld_main.stats }, // segments
-  { MI_STAT_VERSION, MI_STATS_NULL }       // stats
+  { MI_SEGMENT_SPAN_QUEUES_EMPTY, 0, 0, 0, 0, 0, 0, &mi_subproc_default, &tld_main.stats }, // segments
+  { MI_STAT_VERSION, MI_STATS_NULL },      // stats
+  { { NULL, NULL, NULL, 0 } }              // remote free
 };
 
 mi_decl_cache_align mi_heap_t _mi_heap_main = {
@@ -163,17 +173,24 @@ mi_decl_cache_align mi_heap_t _mi_heap_main = {
   0,                // thread id
   0,                // initial cookie
   0,                // arena id
+  -1,               // numa node
   { 0, 0 },         // the key of the main heap can be fixed (unlike page keys that need to be secure!)
   { {0x846ca68b}, {0}, 0, true },  // random
   0,                // page count
+  0, 0,             // page bytes and limit
+  NULL, NULL,       // limit function and argument
   MI_BIN_FULL, 0,   // page retired min/max
   0, 0,             // generic count
   NULL,             // next heap
   false,            // can reclaim
+  false,            // monotonic
   0,                // tag
   #if MI_GUARDED
   0, 0, 0, 0, 0,
   #endif
+  #if MI_PROFILE
+  0, 0,
+  #endif
   MI_SMALL_PAGES_EMPTY,
   MI_PAGE_QUEUES_EMPTY
 };
@@ -236,7 +253,9 @@ static void mi_heap_main_init(void) {
     _mi_heap_main.keys[1] = _mi_heap_random_next(&_mi_heap_main);
     mi_lock_init(&mi_subproc_default.abandoned_os_lock);
     mi_lock_init(&mi_subproc_default.abandoned_os_visit_lock);
+    _mi_profile_init();
     _mi_heap_guarded_init(&_mi_heap_main);
+    _mi_heap_profile_init(&_mi_heap_main);
   }
 }
 
@@ -384,6 +403,69 @@ void _mi_thread_data_collect(void) {
   }
 }
 
+
+// Instead of abandoning the segments of an exiting thread (which then need to be found again through
+// `mi_segment_try_reclaim`), the backing heap of the thread can be parked with its page queues and
+// segments intact and adopted as-is by the next new thread (see `mi_option_heap_recycle`).
+// While parked, the segments have no owning thread (`thread_id == 0`) so all frees go through the
+// thread free lists, but they are not marked as abandoned so no other thread reclaims them.
+
+#define HEAP_RECYCLE_SIZE (16)
+static _Atomic(mi_thread_data_t*) heap_recycle[HEAP_RECYCLE_SIZE];
+
+// set once a thread starts parking its heap: allocations during the rest of the thread exit
+// (for example from other thread local destructors) should never adopt a parked heap as that
+// heap would be left owned by the exited thread.
+static mi_decl_thread bool heap_recycle_exiting = false;
+
+static bool mi_heap_recycle_park(mi_heap_t* heap) {
+  const size_t max = (size_t)mi_option_get_clamp(mi_option_heap_recycle, 0, HEAP_RECYCLE_SIZE);
+  if (max == 0 || heap->tld->segments.subproc != &mi_subproc_default) return false;
+  heap_recycle_exiting = true;
+  // free empty pages and release the segments to no thread
+  mi_heap_collect(heap, false);
+  _mi_heap_set_owner(heap, 0);
+  for (size_t i = 0; i < max; i++) {
+    if (mi_atomic_load_ptr_relaxed(mi_thread_data_t, &heap_recycle[i]) == NULL) {
+      mi_thread_data_t* expected = NULL;
+      if (mi_atomic_cas_ptr_weak_acq_rel(mi_thread_data_t, &heap_recycle[i], &expected, (mi_thread_data_t*)heap)) {
+        return true;
+      }
+    }
+  }
+  // no room: take back ownership so the heap is abandoned as usual
+  _mi_heap_set_owner(heap, _mi_thread_id());
+  return false;
+}
+
+static mi_thread_data_t* mi_heap_recycle_adopt(void) {
+  if (heap_recycle_exiting || mi_option_get(mi_option_heap_recycle) <= 0) return NULL;
+  for (int i = 0; i < HEAP_RECYCLE_SIZE; i++) {
+    if (mi_atomic_load_ptr_relaxed(mi_thread_data_t, &heap_recycle[i]) != NULL) {
+      mi_thread_data_t* td = mi_atomic_exchange_ptr_acq_rel(mi_thread_data_t, &heap_recycle[i], NULL);
+      if (td != NULL) return td;
+    }
+  }
+  return NULL;
+}
+
+// Abandon all parked heaps (on a forced collection, or under memory pressure)
+void _mi_heap_recycle_collect(void) {
+  for (int i = 0; i < HEAP_RECYCLE_SIZE; i++) {
+    if (mi_atomic_load_ptr_relaxed(mi_thread_data_t, &heap_recycle[i]) != NULL) {
+      mi_thread_data_t* td = mi_atomic_exchange_ptr_acq_rel(mi_thread_data_t, &heap_recycle[i], NULL);
+      if (td != NULL) {
+        // take ownership temporarily so the heap can be abandoned as if its thread exited
+        mi_heap_t* heap = &td->heap;
+        _mi_heap_set_owner(heap, _mi_thread_id());
+        _mi_heap_collect_abandon(heap);
+        _mi_stats_done(&heap->tld->stats);
+        mi_thread_data_free(td);
+      }
+    }
+  }
+}
+
 // Initialize the thread local default heap, called from `mi_thread_init`
 static bool _mi_thread_heap_init(void) {
   if (mi_heap_is_initialized(mi_prim_get_default_heap())) return true;
@@ -395,8 +477,16 @@ static bool _mi_thread_heap_init(void) {
     //mi_assert_internal(_mi_heap_default->tld->heap_backing == mi_prim_get_default_heap());
   }
   else {
+    // adopt the parked heap of an exited thread if possible
+    mi_thread_data_t* td = mi_heap_recycle_adopt();
+    if (td != NULL) {
+      _mi_heap_set_owner(&td->heap, _mi_thread_id());
+      _mi_heap_set_default_direct(&td->heap);
+      return false;
+    }
+
     // use `_mi_os_alloc` to allocate directly from the OS
-    mi_thread_data_t* td = mi_thread_data_zalloc();
+    td = mi_thread_data_zalloc();
     if (td == NULL) return false;
 
     mi_tld_t*  tld = &td->tld;
@@ -428,6 +518,9 @@ static bool _mi_thread_heap_done(mi_heap_t* heap) {
   heap = heap->tld->heap_backing;
   if (!mi_heap_is_initialized(heap)) return false;
 
+  // publish buffered non-local frees
+  _mi_remote_free_flush(heap->tld);
+
   // delete all non-backing heaps in this thread
   mi_heap_t* curr = heap->tld->heaps;
   while (curr != NULL) {
@@ -441,6 +534,12 @@ static bool _mi_thread_heap_done(mi_heap_t* heap) {
   mi_assert_internal(heap->tld->heaps == heap && heap->next == NULL);
   mi_assert_internal(mi_heap_is_backing(heap));
 
+  // park the heap for a new thread to adopt it
+  if (heap != &_mi_heap_main && mi_heap_recycle_park(heap)) {
+    _mi_stats_done(&heap->tld->stats);
+    return false;
+  }
+
   // collect if not the main thread
   if (heap != &_mi_heap_main) {
     _mi_heap_collect_abandon(heap);
@@ -645,6 +744,7 @@ void mi_process_init(void) mi_attr_noexcept {
   mi_detect_cpu_features();
   _mi_os_init();
   mi_heap_main_init();
+  _mi_bins_init();
   mi_thread_init();
 
   #if defined(_WIN32)
@@ -656,11 +756,20 @@ void mi_process_init(void) mi_attr_noexcept {
 
   mi_stats_reset();  // only call stat reset *after* thread init (or the heap tld == NULL)
   mi_track_init();
+  _mi_os_region_init();
+  _mi_purge_thread_start();
 
   if (mi_option_is_enabled(mi_option_reserve_huge_os_pages)) {
     size_t pages = mi_option_get_clamp(mi_option_reserve_huge_os_pages, 0, 128*1024);
     long reserve_at = mi_option_get(mi_option_reserve_huge_os_pages_at);
-    if (reserve_at != -1) {
+    if (mi_option_is_enabled(mi_option_reserve_huge_os_pages_async)) {
+      if (reserve_at != -1) {
+        mi_reserve_huge_os_pages_at_async(pages, reserve_at, pages*500);
+      } else {
+        mi_reserve_huge_os_pages_interleave_async(pages, 0, pages*500);
+      }
+    }
+    else if (reserve_at != -1) {
       mi_reserve_huge_os_pages_at(pages, reserve_at, pages*500);
     } else {
       mi_reserve_huge_os_pages_interleave(pages, 0, pages*500);
@@ -687,6 +796,9 @@ void mi_cdecl _mi_process_done(void) {
   mi_heap_t* heap = mi_prim_get_default_heap();  // use prim to not initialize any heap
   mi_assert_internal(heap != NULL);
 
+  // stop the background purge thread (before releasing the thread resources)
+  _mi_purge_thread_stop();
+
   // release any thread specific resources and ensure _mi_thread_done is called on all but the main thread
   _mi_prim_thread_done_auto_done();
 
@@ -94,6 +94,14 @@ typedef struct mi_option_desc_s {
 #define MI_DEFAULT_RESERVE_OS_MEMORY 0
 #endif
 
+#ifndef MI_DEFAULT_PROFILE_SAMPLE_RATE
+#if MI_PROFILE
+#define MI_DEFAULT_PROFILE_SAMPLE_RATE 512   // KiB
+#else
+#define MI_DEFAULT_PROFILE_SAMPLE_RATE 0
+#endif
+#endif
+
 #ifndef MI_DEFAULT_GUARDED_SAMPLE_RATE
 #if MI_GUARDED
 #define MI_DEFAULT_GUARDED_SAMPLE_RATE 4000
@@ -163,12 +171,28 @@ static mi_option_desc_t options[_mi_option_last] =
   { 0,   UNINIT, MI_OPTION(guarded_sample_seed)},
   { 0,   UNINIT, MI_OPTION(target_segments_per_thread) }, // abandon segments beyond this point, or 0 to disable.
   { 10000, UNINIT, MI_OPTION(generic_collect) },          // collect heaps every N (=10000) generic allocation calls
+  { 0,   UNINIT, MI_OPTION(remote_free_buffer) },        // buffer up to N non-local frees per page (and flush on collect or thread exit)
+  { 0,   UNINIT, MI_OPTION(huge_remap) },                // allocate huge blocks in remappable memory (using `mremap` on realloc)
+  { 0,   UNINIT, MI_OPTION(soft_memory_limit) },         // soft limit on committed memory in KiB (0 = only use the cgroup limit)
+  { 0,   UNINIT, MI_OPTION(memory_pressure_interval) }, // check memory pressure every N milli-seconds (0 = never)
+  { 0,   UNINIT, MI_OPTION(purge_thread) },              // purge in a background thread instead of in allocating threads
+  { 0,   UNINIT, MI_OPTION(thp_mode) },                  // 1 = THP aware commit/purge granularity, 2 = also collapse dense segments (Linux only)
+  { 0,   UNINIT, MI_OPTION(arena_numa_bind) },           // bind on-demand reserved arenas to the NUMA node of the requesting thread
+  { 4,   UNINIT, MI_OPTION(abandoned_reclaim_numa_tries) }, // failed local reclaim attempts before reclaiming from remote NUMA nodes
+  { -1,  UNINIT, MI_OPTION(arena_release_delay) },       // release idle on-demand arenas after N milli-seconds (-1 = never)
+  { 0,   UNINIT, MI_OPTION(os_region_reserve) },         // reserve a virtual address range of N KiB at startup for all segments and arenas (use `option_get_size`)
+  { 0,   UNINIT, MI_OPTION(reserve_huge_os_pages_async) }, // reserve huge OS pages at startup in the background
+  { 0,   UNINIT, MI_OPTION(arena_prefault) },            // pre-fault explicitly reserved committed arenas using N threads (0 = disabled)
+  { 0,   UNINIT, MI_OPTION(heap_recycle) },              // park up to N heaps of exited threads for new threads to adopt
+  { MI_DEFAULT_PROFILE_SAMPLE_RATE,
+         UNINIT, MI_OPTION(profile_sample_rate) },       // only used when building with MI_PROFILE: sample every N KiB allocated bytes on average (=512)
 };
 
 static void mi_option_init(mi_option_desc_t* desc);
 
 static bool mi_option_has_size_in_kib(mi_option_t option) {
-  return (option == mi_option_reserve_os_memory || option == mi_option_arena_reserve);
+  return (option == mi_option_reserve_os_memory || option == mi_option_arena_reserve || option == mi_option_soft_memory_limit ||
+          option == mi_option_os_region_reserve || option == mi_option_profile_sample_rate);
 }
 
 void _mi_options_init(void) {
@@ -229,6 +253,9 @@ void mi_options_print(void) mi_attr_noexcept
   #if MI_GUARDED
   _mi_message("guarded build: %s\n", mi_option_get(mi_option_guarded_sample_rate) != 0 ? "enabled" : "disabled");
   #endif
+  #if MI_PROFILE
+  _mi_message("profile build: %s\n", mi_option_get(mi_option_profile_sample_rate) != 0 ? "enabled" : "disabled");
+  #endif
   #if MI_TSAN
   _mi_message("thread santizer enabled\n");
   #endif
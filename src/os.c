@@ -8,6 +8,7 @@ terms of the MIT license. A copy of the license can be found in the file
 #include "mimalloc/internal.h"
 #include "mimalloc/atomic.h"
 #include "mimalloc/prim.h"
+#include "bitmap.h"
 
 #define mi_os_stat_increase(stat,amount)      _mi_stat_increase(&_mi_stats_main.stat, amount)
 #define mi_os_stat_decrease(stat,amount)      _mi_stat_decrease(&_mi_stats_main.stat, amount)
@@ -40,7 +41,8 @@ static mi_os_mem_config_t mi_os_mem_config = {
   MI_DEFAULT_VIRTUAL_ADDRESS_BITS,
   true,     // has overcommit?  (if true we use MAP_NORESERVE on mmap systems)
   false,    // can we partially free allocated blocks? (on mmap systems we can free anywhere in a mapped range, but on Windows we must free the entire span)
-  true      // has virtual reserve? (if true we can reserve virtual address space without using commit or physical memory)
+  true,     // has virtual reserve? (if true we can reserve virtual address space without using commit or physical memory)
+  false     // can we remap memory? (if true we can resize or move memory without copying)
 };
 
 bool _mi_os_has_overcommit(void) {
@@ -144,6 +146,149 @@ void* _mi_os_get_aligned_hint(size_t try_alignment, size_t size) {
 }
 #endif
 
+/* -----------------------------------------------------------
+  Reserved OS region (`mi_option_os_region_reserve`)
+
+  One large virtual address range is reserved (but not committed)
+  at process start. Segments and arenas (allocations aligned at
+  `MI_SEGMENT_ALIGN`) are then carved out of this range by
+  claiming units in the `mi_os_region_inuse` bitmap and committing
+  them in place. Freed ranges are decommitted and protected again
+  but stay reserved, so the range never contains foreign memory and
+  checking if a pointer is ours is just a range check and a bit test.
+  If the region is exhausted (or for larger alignments) we fall
+  back to regular OS allocation outside the region.
+-------------------------------------------------------------- */
+
+#define MI_OS_REGION_UNIT       MI_SEGMENT_ALIGN
+#define MI_OS_REGION_MAX_SIZE   ((size_t)64 << 40)   // 64TiB
+
+static void* mi_os_prim_alloc(size_t size, size_t try_alignment, bool commit, bool allow_large, bool* is_large, bool* is_zero);
+
+static mi_decl_cache_align _Atomic(size_t)  mi_os_region_size;   // = 0 if there is no region
+static _Atomic(uintptr_t)                   mi_os_region_start;
+static mi_bitmap_field_t*                   mi_os_region_inuse;  // a bit for each `MI_OS_REGION_UNIT`
+static mi_decl_cache_align _Atomic(size_t)  mi_os_region_search; // field index to start searching
+
+static size_t mi_os_region_fields(size_t region_size) {
+  return (region_size / (MI_OS_REGION_UNIT * MI_BITMAP_FIELD_BITS));
+}
+
+// Is `p` inside the reserved region? (regardless of whether it is in use)
+bool _mi_os_region_contains(const void* p) {
+  const size_t size = mi_atomic_load_acquire(&mi_os_region_size);
+  return (((uintptr_t)p - mi_atomic_load_relaxed(&mi_os_region_start)) < size);  // false if size == 0
+}
+
+// Is `p` inside a range of the reserved region that is currently allocated?
+bool _mi_os_region_is_inuse(const void* p) {
+  if (!_mi_os_region_contains(p)) return false;
+  const size_t unit = ((uintptr_t)p - mi_atomic_load_relaxed(&mi_os_region_start)) / MI_OS_REGION_UNIT;
+  const size_t fields = mi_os_region_fields(mi_atomic_load_relaxed(&mi_os_region_size));
+  return _mi_bitmap_is_claimed(mi_os_region_inuse, fields, 1, mi_bitmap_index_create_from_bit(unit));
+}
+
+// Reserve the region; called once at process initialization.
+void _mi_os_region_init(void) {
+  #if (MI_INTPTR_SIZE >= 8)
+  if (mi_atomic_load_relaxed(&mi_os_region_size) != 0) return;
+  size_t size = mi_option_get_size(mi_option_os_region_reserve);
+  if (size == 0) return;
+  if (!mi_os_mem_config.has_virtual_reserve || mi_os_mem_config.virtual_address_bits < 46) {
+    _mi_warning_message("cannot reserve an OS region as there is not enough virtual address space\n");
+    return;
+  }
+  size = _mi_align_up(size, MI_OS_REGION_UNIT * MI_BITMAP_FIELD_BITS);
+  if (size > MI_OS_REGION_MAX_SIZE) { size = MI_OS_REGION_MAX_SIZE; }
+  const size_t fields = mi_os_region_fields(size);
+  mi_memid_t bitmap_memid;
+  mi_bitmap_field_t* inuse = (mi_bitmap_field_t*)_mi_os_alloc(fields * sizeof(mi_bitmap_field_t), &bitmap_memid);
+  if (inuse == NULL) return;
+  if (!bitmap_memid.initially_zero) { _mi_memzero(inuse, fields * sizeof(mi_bitmap_field_t)); }
+  // reserve the virtual range (without committing it); over-allocate so we can align it (it is never freed)
+  bool is_large = false;
+  bool is_zero = false;
+  void* base = mi_os_prim_alloc(size + MI_OS_REGION_UNIT, 1, false /* commit */, false /* allow large */, &is_large, &is_zero);
+  void* start = (base == NULL ? NULL : mi_align_up_ptr(base, MI_OS_REGION_UNIT));
+  if (start == NULL) {
+    _mi_os_free(inuse, fields * sizeof(mi_bitmap_field_t), bitmap_memid);
+    _mi_warning_message("unable to reserve an OS region of %zu GiB\n", size / MI_GiB);
+    return;
+  }
+  mi_os_stat_decrease(reserved, size + MI_OS_REGION_UNIT);  // only count the parts that are in use
+  mi_os_region_inuse = inuse;
+  mi_atomic_store_relaxed(&mi_os_region_start, (uintptr_t)start);
+  mi_atomic_store_release(&mi_os_region_size, size);
+  _mi_verbose_message("reserved an OS region of %zu GiB at %p\n", size / MI_GiB, start);
+  #endif
+}
+
+// Allocate from the reserved region; returns NULL if there is no region, or if it is exhausted.
+static void* mi_os_region_alloc(size_t size, size_t alignment, bool commit, mi_memid_t* memid) {
+  const size_t region_size = mi_atomic_load_acquire(&mi_os_region_size);
+  if (region_size == 0 || alignment < MI_OS_REGION_UNIT || (alignment % MI_OS_REGION_UNIT) != 0) return NULL;
+  const size_t fields = mi_os_region_fields(region_size);
+  const size_t count = _mi_divide_up(size, MI_OS_REGION_UNIT);
+  const size_t align_units = alignment / MI_OS_REGION_UNIT;
+  const size_t start_field = mi_atomic_load_relaxed(&mi_os_region_search);
+  // for larger alignments, over-claim and unclaim the unaligned units around it afterwards
+  mi_bitmap_index_t bitmap_idx;
+  if (!_mi_bitmap_try_find_from_claim_across(mi_os_region_inuse, fields, (start_field < fields ? start_field : 0), count + align_units - 1, &bitmap_idx)) {
+    return NULL;
+  }
+  mi_atomic_store_relaxed(&mi_os_region_search, mi_bitmap_index_field(bitmap_idx));
+  const uintptr_t start = mi_atomic_load_relaxed(&mi_os_region_start);
+  size_t unit = mi_bitmap_index_bit(bitmap_idx);
+  if (align_units > 1) {
+    const size_t pre = (_mi_align_up(start + unit*MI_OS_REGION_UNIT, alignment) - (start + unit*MI_OS_REGION_UNIT)) / MI_OS_REGION_UNIT;
+    const size_t post = align_units - 1 - pre;
+    if (pre > 0) { _mi_bitmap_unclaim_across(mi_os_region_inuse, fields, pre, bitmap_idx); }
+    if (post > 0) { _mi_bitmap_unclaim_across(mi_os_region_inuse, fields, post, mi_bitmap_index_create_from_bit(unit + pre + count)); }
+    unit += pre;
+    bitmap_idx = mi_bitmap_index_create_from_bit(unit);
+  }
+  uint8_t* const p = (uint8_t*)start + (unit * MI_OS_REGION_UNIT);
+  mi_assert_internal(_mi_is_aligned(p, alignment));
+  const size_t psize = count * MI_OS_REGION_UNIT;
+  if (commit) {
+    bool os_is_zero = false;
+    int err = _mi_prim_commit(p, psize, &os_is_zero);
+    if (err != 0) {
+      _mi_bitmap_unclaim_across(mi_os_region_inuse, fields, count, bitmap_idx);
+      return NULL;
+    }
+    mi_os_stat_increase(committed, psize);
+  }
+  mi_os_stat_increase(reserved, psize);
+  // memory in the region is either fresh or was decommitted when freed, and is always zero
+  *memid = _mi_memid_create_os(commit, true /* is_zero */, false /* is_large */);
+  memid->memkind = MI_MEM_OS_REGION;
+  memid->mem.os.base = p;
+  memid->mem.os.size = psize;
+  return p;
+}
+
+// Return memory to the region: decommit and protect it (but keep it reserved)
+static void mi_os_region_free(void* base, size_t size, size_t commit_size) {
+  mi_assert_internal(_mi_os_region_contains(base) && _mi_is_aligned(base, MI_OS_REGION_UNIT));
+  const size_t fields = mi_os_region_fields(mi_atomic_load_relaxed(&mi_os_region_size));
+  const size_t count = _mi_divide_up(size, MI_OS_REGION_UNIT);
+  const size_t psize = count * MI_OS_REGION_UNIT;
+  bool needs_recommit = true;
+  int err = _mi_prim_decommit(base, psize, &needs_recommit);
+  if (err == 0) { err = _mi_prim_protect(base, psize, true); }
+  if (commit_size > 0) { mi_os_stat_decrease(committed, commit_size); }
+  mi_os_stat_decrease(reserved, psize);
+  if (err != 0) {
+    // keep it claimed as we can no longer guarantee the range is zero
+    _mi_warning_message("unable to decommit OS region memory (error: %d (0x%x), size: 0x%zx bytes, address: %p)\n", err, err, psize, base);
+    return;
+  }
+  const size_t unit = ((uintptr_t)base - mi_atomic_load_relaxed(&mi_os_region_start)) / MI_OS_REGION_UNIT;
+  _mi_bitmap_unclaim_across(mi_os_region_inuse, fields, count, mi_bitmap_index_create_from_bit(unit));
+}
+
+
 /* -----------------------------------------------------------
   Free memory
 -------------------------------------------------------------- */
@@ -186,6 +331,9 @@ void _mi_os_free_ex(void* addr, size_t size, bool still_committed, mi_memid_t me
       mi_assert(memid.is_pinned);
       mi_os_free_huge_os_pages(base, csize);
     }
+    else if (memid.memkind == MI_MEM_OS_REGION) {
+      mi_os_region_free(base, csize, (still_committed ? commit_size : 0));
+    }
     else {
       mi_os_prim_free(base, csize, (still_committed ? commit_size : 0));
     }
@@ -337,10 +485,14 @@ void* _mi_os_alloc_aligned(size_t size, size_t alignment, bool commit, bool allo
   size = _mi_os_good_alloc_size(size);
   alignment = _mi_align_up(alignment, _mi_os_page_size());
 
+  // carve segments and arenas from the reserved region if possible
+  void* p = mi_os_region_alloc(size, alignment, commit, memid);
+  if (p != NULL) return p;
+
   bool os_is_large = false;
   bool os_is_zero  = false;
   void* os_base = NULL;
-  void* p = mi_os_prim_alloc_aligned(size, alignment, commit, allow_large, &os_is_large, &os_is_zero, &os_base );
+  p = mi_os_prim_alloc_aligned(size, alignment, commit, allow_large, &os_is_large, &os_is_zero, &os_base );
   if (p != NULL) {
     *memid = _mi_memid_create_os(commit, os_is_zero, os_is_large);
     memid->mem.os.base = os_base;
@@ -385,6 +537,65 @@ void* _mi_os_alloc_aligned_at_offset(size_t size, size_t alignment, size_t offse
   }
 }
 
+/* -----------------------------------------------------------
+  OS remappable allocation. This is used for huge blocks so
+  these can be reallocated by remapping their pages (using `mremap`
+  on Linux) instead of copying. Remappable memory is always committed.
+----------------------------------------------------------- */
+
+// Allocate committed memory that can later be resized with `_mi_os_remap`.
+// Returns NULL if the OS does not support remapping.
+void* _mi_os_alloc_remappable(size_t size, size_t alignment, mi_memid_t* memid) {
+  *memid = _mi_memid_none();
+  if (!mi_os_mem_config.has_remap || size == 0) return NULL;
+  if (mi_atomic_load_relaxed(&mi_os_region_size) != 0) return NULL;  // remapping would move the memory out of the reserved region
+  size = _mi_os_good_alloc_size(size);
+  void* p = _mi_os_alloc_aligned(size, alignment, true /* commit */, false /* allow_large */, memid);
+  if (p == NULL) return NULL;
+  memid->mem.os.size = size;
+  if (memid->mem.os.base != p) {
+    // cannot remap if we needed to over-allocate to align (should not happen on systems with remap)
+    _mi_os_free(p, size, *memid);
+    *memid = _mi_memid_none();
+    return NULL;
+  }
+  memid->memkind = MI_MEM_OS_REMAP;
+  return p;
+}
+
+// Resize remappable memory to (at least) `newsize` bytes without copying. The memory may move
+// to a new address aligned to `alignment`. Returns the new address and updates the `memid`,
+// or returns NULL on failure (in which case the original memory is unchanged).
+void* _mi_os_remap(void* p, size_t newsize, size_t alignment, mi_memid_t* memid) {
+  mi_assert_internal(memid->memkind == MI_MEM_OS_REMAP && memid->mem.os.base == p);
+  if (p == NULL || memid->memkind != MI_MEM_OS_REMAP || newsize == 0) return NULL;
+  const size_t size = memid->mem.os.size;
+  newsize = _mi_os_good_alloc_size(newsize);
+  alignment = _mi_align_up(alignment, _mi_os_page_size());
+  if (newsize == size) return p;
+
+  void* newp = NULL;
+  int err = _mi_prim_remap(p, size, newsize, alignment, &newp);
+  mi_os_stat_counter_increase(mmap_calls, 1);
+  if (err != 0 || newp == NULL) {
+    _mi_warning_message("unable to remap OS memory (error: %d (0x%x), address: %p, size: 0x%zx bytes, new size: 0x%zx bytes)\n", err, err, p, size, newsize);
+    return NULL;
+  }
+  mi_assert_internal(_mi_is_aligned(newp, alignment));
+  if (newsize > size) {
+    mi_os_stat_increase(reserved, newsize - size);
+    mi_os_stat_increase(committed, newsize - size);
+  }
+  else {
+    mi_os_stat_decrease(reserved, size - newsize);
+    mi_os_stat_decrease(committed, size - newsize);
+  }
+  memid->mem.os.base = newp;
+  memid->mem.os.size = newsize;
+  return newp;
+}
+
+
 /* -----------------------------------------------------------
   OS memory API: reset, commit, decommit, protect, unprotect.
 ----------------------------------------------------------- */
@@ -524,6 +735,89 @@ bool _mi_os_purge(void* p, size_t size) {
   return _mi_os_purge_ex(p, size, true, size);
 }
 
+// Purge many fully committed ranges (given in increasing address order) at once. Ranges are page aligned
+// conservatively and adjacent ranges are coalesced, and where supported all ranges are submitted to
+// the OS in a single call. Note: the `ranges` array is overwritten.
+// Returns true if the memory needs to be recommitted if it is to be re-used later on.
+bool _mi_os_purge_ranges(mi_os_range_t* ranges, size_t count)
+{
+  if (count == 0 || mi_option_get(mi_option_purge_delay) < 0) return false;  // is purging allowed?
+  const bool decommit = (mi_option_is_enabled(mi_option_purge_decommits) && !_mi_preloading());
+
+  // page align and coalesce in-place
+  size_t n = 0;
+  for (size_t i = 0; i < count; i++) {
+    mi_os_stat_increase(purged, ranges[i].size);
+    if (decommit) { mi_os_stat_decrease(committed, ranges[i].size); }
+    size_t csize;
+    void* start = mi_os_page_align_area_conservative(ranges[i].start, ranges[i].size, &csize);
+    if (csize == 0) continue;
+    if (n > 0 && (uint8_t*)ranges[n-1].start + ranges[n-1].size == (uint8_t*)start) {
+      ranges[n-1].size += csize;
+    }
+    else {
+      ranges[n].start = start;
+      ranges[n].size  = csize;
+      n++;
+    }
+  }
+  if (n == 0) return false;
+  mi_os_stat_counter_increase(purge_calls, n);
+  if (!decommit) {
+    mi_os_stat_counter_increase(reset_calls, n);
+    for (size_t i = 0; i < n; i++) {
+      mi_os_stat_increase(reset, ranges[i].size);
+      #if (MI_DEBUG>1) && !MI_SECURE && !MI_TRACK_ENABLED
+      memset(ranges[i].start, 0, ranges[i].size); // pretend it is eagerly reset
+      #endif
+    }
+  }
+
+  bool needs_recommit = decommit;
+  int err = _mi_prim_purge_ranges(ranges, n, decommit, &needs_recommit);
+  if (err != 0) {
+    _mi_warning_message("cannot %s OS memory (error: %d (0x%x), ranges: %zu, first address: %p)\n", (decommit ? "decommit" : "reset"), err, err, n, ranges[0].start);
+  }
+  return (decommit && needs_recommit);
+}
+
+// Try to collapse a (huge page aligned) range into transparent huge pages. Once the OS reports
+// that collapsing is not supported, we no longer try.
+bool _mi_os_collapse(void* addr, size_t size) {
+  static _Atomic(size_t) supported = MI_ATOMIC_VAR_INIT(1);
+  if (mi_atomic_load_relaxed(&supported) == 0) return false;
+  const int err = _mi_prim_collapse(addr, size);
+  if (err == 0) {
+    _mi_verbose_message("collapsed OS memory into huge pages (address: %p, size: 0x%zx bytes)\n", addr, size);
+    return true;
+  }
+  if (err == EINVAL || err == ENOTSUP) {
+    mi_atomic_store_release(&supported, (size_t)0);
+  }
+  return false;
+}
+
+// Populate the physical pages of a committed range ahead of use. If the OS does not support
+// this directly, we touch each OS page instead (without changing its contents).
+void _mi_os_populate(void* addr, size_t size) {
+  static _Atomic(size_t) supported = MI_ATOMIC_VAR_INIT(1);
+  addr = mi_os_page_align_area_conservative(addr, size, &size);
+  if (size == 0) return;
+  if (mi_atomic_load_relaxed(&supported) != 0) {
+    const int err = _mi_prim_populate(addr, size);
+    if (err == 0) return;
+    if (err != EINVAL && err != ENOTSUP) {
+      _mi_warning_message("unable to populate OS memory (error: %d (0x%x), address: %p, size: 0x%zx bytes)\n", err, err, addr, size);
+      return;
+    }
+    mi_atomic_store_release(&supported, (size_t)0);
+  }
+  const size_t psize = _mi_os_page_size();
+  for (volatile uint8_t* p = (volatile uint8_t*)addr; p < (uint8_t*)addr + size; p += psize) {
+    *p = *p;
+  }
+}
+
 // Protect a region in memory to be not accessible.
 static  bool mi_os_protectx(void* addr, size_t size, bool protect) {
   // page align conservatively within the range
@@ -711,3 +1005,73 @@ int _mi_os_numa_node_get(void) {
   if (numa_node >= numa_count) { numa_node = numa_node % numa_count; }
   return (int)numa_node;
 }
+
+// Prefer the physical memory of a range to be on a given NUMA node.
+// Returns `true` if the range was bound.
+bool _mi_os_numa_bind(void* addr, size_t size, int numa_node) {
+  if (numa_node < 0 || _mi_os_numa_node_count() <= 1) return false;
+  const int err = _mi_prim_numa_bind(addr, size, numa_node);
+  if (err != 0) {
+    _mi_verbose_message("unable to bind memory to numa node %d (error: %d (0x%x), address: %p, size: 0x%zx bytes)\n", numa_node, err, err, addr, size);
+    return false;
+  }
+  return true;
+}
+
+
+/* ----------------------------------------------------------------------------
+Memory pressure: compare our committed memory against a soft limit
+(`mi_option_soft_memory_limit` or the cgroup memory limit) and check the
+OS pressure stall information. Under pressure we purge more eagerly.
+-----------------------------------------------------------------------------*/
+
+static _Atomic(size_t)     mi_pressure_level;       // 0: none, 1: moderate, 2: critical
+static _Atomic(mi_msecs_t) mi_pressure_next_check;  // time of the next check
+
+static size_t mi_os_memory_pressure_level(void) {
+  mi_memory_pressure_t mp = { 0, 0 };
+  if (!_mi_prim_memory_pressure(&mp)) { mp.limit = 0; mp.stall = 0; }
+  size_t limit = mi_option_get_size(mi_option_soft_memory_limit);
+  if (mp.limit > 0 && (limit == 0 || mp.limit < limit)) { limit = mp.limit; }
+  const int64_t committed = mi_atomic_loadi64_relaxed((_Atomic(int64_t)*)&_mi_stats_main.committed.current);
+  const size_t used = (committed > 0 ? (size_t)committed : 0);
+  if ((limit > 0 && used >= limit) || mp.stall >= 1000) return 2;       // over the limit, or stalled >= 10%
+  if ((limit > 0 && used >= (limit/10)*9) || mp.stall >= 100) return 1;  // within 10% of the limit, or stalled >= 1%
+  return 0;
+}
+
+// Periodically (every `mi_option_memory_pressure_interval` milli-seconds) re-evaluate the memory pressure.
+// Only one thread does the check at a time. Returns `true` if this thread did the check and found
+// that we are under (moderate or critical) pressure; the caller should then collect.
+bool _mi_os_memory_pressure_check(bool force) {
+  const long interval = mi_option_get(mi_option_memory_pressure_interval);
+  if (interval <= 0 && !force) return false;
+  const mi_msecs_t now = _mi_clock_now();
+  mi_msecs_t expire = mi_atomic_loadi64_relaxed(&mi_pressure_next_check);
+  if (!force && now < expire) return false;
+  if (!mi_atomic_casi64_strong_acq_rel(&mi_pressure_next_check, &expire, now + (interval > 0 ? interval : 1000))) {
+    return false;  // another thread is checking
+  }
+  const size_t level = mi_os_memory_pressure_level();
+  const size_t old_level = mi_atomic_exchange_relaxed(&mi_pressure_level, level);
+  if (level != old_level) {
+    _mi_verbose_message("memory pressure level changed from %zu to %zu\n", old_level, level);
+  }
+  return (level > 0);
+}
+
+// Current memory pressure level (0: none, 1: moderate, 2: critical)
+size_t _mi_os_memory_pressure(void) {
+  return mi_atomic_load_relaxed(&mi_pressure_level);
+}
+
+// The effective purge delay: shorter under moderate pressure and immediate under critical pressure.
+long _mi_os_purge_delay(void) {
+  const long delay = mi_option_get(mi_option_purge_delay);
+  if (delay <= 0) return delay;  // no purging, or already immediate
+  switch (mi_atomic_load_relaxed(&mi_pressure_level)) {
+    case 0:  return delay;
+    case 1:  return (delay >= 8 ? delay/8 : 1);
+    default: return 0;
+  }
+}
@@ -53,12 +53,37 @@ static inline bool mi_page_queue_is_special(const mi_page_queue_t* pq) {
   Bins
 ----------------------------------------------------------- */
 
+// Custom size classes: when extra exact size classes are given (at build time
+// through `MI_SIZE_CLASSES` or at process start through `MIMALLOC_SIZE_CLASSES`),
+// these are merged with the default size classes and the bins are renumbered.
+// `mi_bin_wsize[bin]` is the size in words of each bin (for `1 <= bin <= mi_bin_count`).
+// There is enough room as the default size classes only use the bins up to `MI_MEDIUM_OBJ_WSIZE_MAX`.
+static size_t mi_bin_wsize[MI_BIN_HUGE];
+static size_t mi_bin_count;  // 0 if using the default size classes
+
+static size_t mi_bin_custom(size_t wsize) {
+  if mi_unlikely(wsize > MI_MEDIUM_OBJ_WSIZE_MAX) return MI_BIN_HUGE;
+  // binary search for the smallest size class that fits
+  size_t lo = 1;
+  size_t hi = mi_bin_count;
+  while (lo < hi) {
+    const size_t mid = (lo + hi) / 2;
+    if (mi_bin_wsize[mid] < wsize) { lo = mid + 1; }
+                              else { hi = mid; }
+  }
+  mi_assert_internal(mi_bin_wsize[lo] >= wsize);
+  return lo;
+}
+
 // Return the bin for a given field size.
 // Returns MI_BIN_HUGE if the size is too large.
 // We use `wsize` for the size in "machine word sizes",
 // i.e. byte size == `wsize*sizeof(void*)`.
 static inline size_t mi_bin(size_t size) {
   size_t wsize = _mi_wsize_from_size(size);
+  if mi_unlikely(mi_bin_count > 0) {
+    return mi_bin_custom(wsize);
+  }
 #if defined(MI_ALIGN4W)
   if mi_likely(wsize <= 4) {
     return (wsize <= 1 ? 1 : (wsize+1)&~1); // round to double word sizes
@@ -102,9 +127,116 @@ size_t _mi_bin(size_t size) {
 }
 
 size_t _mi_bin_size(size_t bin) {
+  if mi_unlikely(mi_bin_count > 0 && bin > 0 && bin < MI_BIN_HUGE) {
+    return (bin <= mi_bin_count ? mi_bin_wsize[bin] * sizeof(uintptr_t) : 0);  // 0 for unused bins
+  }
   return _mi_heap_empty.pages[bin].block_size;
 }
 
+// Set the block size of each page queue of a fresh heap to the custom size classes (if any)
+void _mi_heap_init_queues(mi_heap_t* heap) {
+  if mi_likely(mi_bin_count == 0) return;  // the default size classes are statically initialized
+  for (size_t bin = 1; bin < MI_BIN_HUGE; bin++) {
+    heap->pages[bin].block_size = _mi_bin_size(bin);
+  }
+}
+
+// Round a size class up to the minimal alignment (as the default classes in `mi_bin`)
+static size_t mi_bin_wsize_align(size_t wsize) {
+  #if defined(MI_ALIGN4W)
+  if (wsize > 4) return _mi_align_up(wsize, 4);
+  #endif
+  #if defined(MI_ALIGN4W) || defined(MI_ALIGN2W)
+  if (wsize > 1) return _mi_align_up(wsize, 2);
+  #endif
+  return (wsize == 0 ? 1 : wsize);
+}
+
+// Insert an extra size class (in bytes) in the sorted `mi_bin_wsize` table
+static void mi_bins_add_class(size_t size) {
+  if (size == 0 || size > MI_MEDIUM_OBJ_SIZE_MAX) {
+    _mi_warning_message("size class %zu is ignored (as it is not between 1 and %zu bytes)\n", size, (size_t)MI_MEDIUM_OBJ_SIZE_MAX);
+    return;
+  }
+  const size_t wsize = mi_bin_wsize_align(_mi_wsize_from_size(size));
+  size_t i = 1;
+  while (i <= mi_bin_count && mi_bin_wsize[i] < wsize) { i++; }
+  if (i <= mi_bin_count && mi_bin_wsize[i] == wsize) return;  // already present
+  if (mi_bin_count >= MI_BIN_HUGE - 1) {
+    _mi_warning_message("size class %zu is ignored (too many size classes)\n", size);
+    return;
+  }
+  for (size_t j = mi_bin_count; j >= i; j--) {
+    mi_bin_wsize[j+1] = mi_bin_wsize[j];
+  }
+  mi_bin_wsize[i] = wsize;
+  mi_bin_count++;
+}
+
+// Parse a list of sizes in bytes separated by commas (or semicolons or spaces)
+static void mi_bins_add_classes(const char* s) {
+  while (*s != 0) {
+    if (*s >= '0' && *s <= '9') {
+      size_t size = 0;
+      while (*s >= '0' && *s <= '9') {
+        if (size <= MI_MEDIUM_OBJ_SIZE_MAX) { size = 10*size + (size_t)(*s - '0'); }
+        s++;
+      }
+      mi_bins_add_class(size);
+    }
+    else if (*s == ',' || *s == ';' || *s == ' ') {
+      s++;
+    }
+    else {
+      _mi_warning_message("invalid size class list at \"%s\" (use a comma separated list of sizes in bytes)\n", s);
+      return;
+    }
+  }
+}
+
+// Called once at process start: set up custom size classes (if any)
+void _mi_bins_init(void) {
+  char s[256+1];
+  const bool found = _mi_getenv("mimalloc_size_classes", s, sizeof(s));
+  #if !defined(MI_SIZE_CLASSES)
+  if mi_likely(!found) return;
+  #endif
+  mi_heap_t* const heap = _mi_heap_main_get();
+  if (heap->page_count > 0) {
+    _mi_warning_message("custom size classes are ignored as the main heap already allocated\n");
+    return;
+  }
+  // start with the default size classes that are in use (some bins are skipped due to the minimal alignment)
+  mi_assert_internal(mi_bin_count == 0);
+  size_t count = 0;
+  for (size_t bin = 1; bin < MI_BIN_HUGE; bin++) {
+    const size_t bsize = _mi_heap_empty.pages[bin].block_size;
+    if (bsize > MI_MEDIUM_OBJ_SIZE_MAX) break;
+    if (mi_bin(bsize) == bin) {
+      count++;
+      mi_bin_wsize[count] = _mi_wsize_from_size(bsize);
+    }
+  }
+  mi_assert_internal(mi_bin_wsize[count] == MI_MEDIUM_OBJ_WSIZE_MAX);
+  // and add the custom classes
+  mi_bin_count = count;
+  #if defined(MI_SIZE_CLASSES)
+  static const size_t build_classes[] = { MI_SIZE_CLASSES };
+  for (size_t i = 0; i < sizeof(build_classes)/sizeof(build_classes[0]); i++) {
+    mi_bins_add_class(build_classes[i]);
+  }
+  #endif
+  if (found) {
+    mi_bins_add_classes(s);
+  }
+  if (mi_bin_count == count) {
+    mi_bin_count = 0;  // no extra classes; use the default `mi_bin`
+    return;
+  }
+  _mi_heap_init_queues(heap);
+  _mi_verbose_message("using %zu size classes (%zu extra)\n", mi_bin_count, mi_bin_count - count);
+}
+
 // Good size for allocation
 size_t mi_good_size(size_t size) mi_attr_noexcept {
   if (size <= MI_MEDIUM_OBJ_SIZE_MAX) {
@@ -351,6 +483,26 @@ static void mi_page_queue_enqueue_from_full(mi_page_queue_t* to, mi_page_queue_t
   mi_page_queue_enqueue_from_ex(to, from, true /* enqueue at the end of the `to` queue? */, page);
 }
 
+// Take a page out of its queue so it is not allocated from (used for defragmentation).
+// The page is no longer in any queue until it is relinked.
+void _mi_page_queue_unlink(mi_page_t* page) {
+  mi_assert_internal(page != NULL);
+  mi_page_queue_remove(mi_page_queue_of(page), page);
+  mi_assert_internal(!mi_page_is_in_full(page));
+}
+
+// Push an unlinked page back into its queue; returns that queue.
+mi_page_queue_t* _mi_page_queue_relink(mi_page_t* page) {
+  mi_assert_internal(page != NULL && page->next == NULL && page->prev == NULL);
+  mi_heap_t* const heap = mi_page_heap(page);
+  mi_page_queue_t* const pq = mi_heap_page_queue_of(heap, page);
+  mi_page_queue_push(heap, pq, page);
+  // the page may have left the full queue when unlinked: reset the delayed free state as it is owned by a live heap again
+  // (this waits for any outstanding MI_DELAYED_FREEING and overrides MI_NEVER_DELAYED_FREE)
+  _mi_page_use_delayed_free(page, MI_USE_DELAYED_FREE, true);
+  return pq;
+}
+
 // Only called from `mi_heap_absorb`.
 size_t _mi_page_queue_append(mi_heap_t* heap, mi_page_queue_t* pq, mi_page_queue_t* append) {
   mi_assert_internal(mi_heap_contains_queue(heap,pq));
@@ -266,9 +266,17 @@ void _mi_page_reclaim(mi_heap_t* heap, mi_page_t* page) {
   // TODO: push on full queue immediately if it is full?
   mi_page_queue_t* pq = mi_page_queue(heap, mi_page_block_size(page));
   mi_page_queue_push(heap, pq, page);
+  heap->page_bytes += mi_page_slices_size(page);
   mi_assert_expensive(_mi_page_is_valid(page));
 }
 
+// estimate the size of a fresh page for a given block size (see `_mi_segment_page_alloc`)
+static size_t mi_page_size_estimate(size_t block_size) {
+  if (block_size <= MI_SMALL_OBJ_SIZE_MAX) return MI_SMALL_PAGE_SIZE;
+  if (block_size <= MI_MEDIUM_OBJ_SIZE_MAX) return MI_MEDIUM_PAGE_SIZE;
+  return _mi_align_up(block_size, MI_SEGMENT_SLICE_SIZE);
+}
+
 // allocate a fresh page from a segment
 static mi_page_t* mi_page_fresh_alloc(mi_heap_t* heap, mi_page_queue_t* pq, size_t block_size, size_t page_alignment) {
   #if !MI_HUGE_PAGE_ABANDON
@@ -276,6 +284,10 @@ static mi_page_t* mi_page_fresh_alloc(mi_heap_t* heap, mi_page_queue_t* pq, size
   mi_assert_internal(mi_heap_contains_queue(heap, pq));
   mi_assert_internal(page_alignment > 0 || block_size > MI_MEDIUM_OBJ_SIZE_MAX || block_size == pq->block_size);
   #endif
+  if mi_unlikely(!mi_heap_page_limit_allows(heap, mi_page_size_estimate(block_size))) {
+    // over the heap limit (see `_mi_malloc_generic`)
+    return NULL;
+  }
   mi_page_t* page = _mi_segment_page_alloc(heap, block_size, page_alignment, &heap->tld->segments);
   if (page == NULL) {
     // this may be out-of-memory, or an abandoned page was reclaimed (and in our queue)
@@ -292,6 +304,7 @@ static mi_page_t* mi_page_fresh_alloc(mi_heap_t* heap, mi_page_queue_t* pq, size
   mi_page_init(heap, page, full_block_size, heap->tld);
   mi_heap_stat_increase(heap, pages, 1);
   mi_heap_stat_increase(heap, page_bins[mi_page_bin(page)], 1);
+  heap->page_bytes += mi_page_slices_size(page);
   if (pq != NULL) { mi_page_queue_push(heap, pq, page); }
   mi_assert_expensive(_mi_page_is_valid(page));
   return page;
@@ -372,6 +385,29 @@ static void mi_page_to_full(mi_page_t* page, mi_page_queue_t* pq) {
   _mi_page_free_collect(page,false);  // try to collect right away in case another thread freed just before MI_USE_DELAYED_FREE was set
 }
 
+// Resize a huge page in remappable memory to fit a block of `size` bytes (without copying).
+// As the page may move, it is taken out of its page queue and pushed back at its new address.
+// Returns the (new) page, or NULL on failure in which case the page is unchanged.
+mi_page_t* _mi_page_huge_remap(mi_page_t* page, size_t size) {
+  mi_assert_internal(page != NULL && mi_page_is_huge(page));
+  mi_assert_expensive(_mi_page_is_valid(page));
+  mi_heap_t* const heap = mi_page_heap(page);
+  const size_t old_size = mi_page_slices_size(page);
+  if (size > old_size && !mi_heap_page_limit_allows(heap, size - old_size)) return NULL;
+  mi_page_queue_t* const pq = mi_page_queue_of(page);
+  const bool in_full = mi_page_is_in_full(page);
+  mi_page_queue_remove(pq, page);
+  mi_page_t* const newpage = _mi_segment_huge_page_remap(page, size, &heap->tld->segments);
+  if (newpage != NULL) {
+    page = newpage;
+    heap->page_bytes = heap->page_bytes - old_size + mi_page_slices_size(page);
+  }
+  mi_page_set_in_full(page, in_full);
+  mi_page_queue_push(heap, pq, page);
+  mi_assert_expensive(_mi_page_is_valid(page));
+  return newpage;
+}
+
 
 // Abandon a page with used blocks at the end of a thread.
 // Note: only call if it is ensured that no references exist from
@@ -388,6 +424,7 @@ void _mi_page_abandon(mi_page_t* page, mi_page_queue_t* pq) {
   // remove from our page list
   mi_segments_tld_t* segments_tld = &pheap->tld->segments;
   mi_page_queue_remove(pq, page);
+  pheap->page_bytes -= mi_page_slices_size(page);
 
   // page is no longer associated with our heap
   mi_assert_internal(mi_page_thread_free_flag(page)==MI_NEVER_DELAYED_FREE);
@@ -436,14 +473,16 @@ void _mi_page_free(mi_page_t* page, mi_page_queue_t* pq, bool force) {
   mi_assert_internal(mi_page_all_free(page));
   mi_assert_internal(mi_page_thread_free_flag(page)!=MI_DELAYED_FREEING);
 
-  // no more aligned blocks in here
+  // no more aligned (or sampled) blocks in here
   mi_page_set_has_aligned(page, false);
+  mi_page_set_has_sampled(page, false);
 
   // remove from the page list
   // (no need to do _mi_heap_delayed_free first as all blocks are already free)
   mi_heap_t* heap = mi_page_heap(page);
   mi_segments_tld_t* segments_tld = &heap->tld->segments;
   mi_page_queue_remove(pq, page);
+  heap->page_bytes -= mi_page_slices_size(page);
 
   // and free it
   mi_heap_stat_decrease(heap, page_bins[mi_page_bin(page)], 1);
@@ -466,6 +505,7 @@ void _mi_page_retire(mi_page_t* page) mi_attr_noexcept {
   mi_assert_internal(mi_page_all_free(page));
 
   mi_page_set_has_aligned(page, false);
+  mi_page_set_has_sampled(page, false);
 
   // don't retire too often..
   // (or we end up retiring and re-allocating most of the time)
@@ -727,6 +767,10 @@ static void mi_page_init(mi_heap_t* heap, mi_page_t* page, size_t block_size, mi
   mi_assert_internal(page->block_size_shift == 0 || (block_size == ((size_t)1 << page->block_size_shift)));
   mi_assert_expensive(mi_page_is_valid_init(page));
 
+  // pages of a monotonic heap have no free list but bump allocate (see `mi_heap_monotonic_malloc`)
+  mi_page_set_monotonic(page, heap->monotonic && block_size <= MI_MEDIUM_OBJ_SIZE_MAX);
+  if (mi_page_is_monotonic(page)) return;
+
   // initialize an initial free list
   mi_page_extend_free(heap,page,tld);
   mi_assert(mi_page_immediate_available(page));
@@ -876,6 +920,76 @@ static inline mi_page_t* mi_find_free_page(mi_heap_t* heap, size_t size) {
 }
 
 
+/* -----------------------------------------------------------
+  Monotonic heaps allocate by bumping through the blocks of
+  fresh pages without ever building a free list. Frees are
+  ignored and pages are only released with `mi_heap_destroy`.
+----------------------------------------------------------- */
+
+// Find a page with blocks left to bump allocate (or NULL if out of memory).
+static mi_page_t* mi_heap_monotonic_page(mi_heap_t* heap, size_t size) {
+  mi_page_queue_t* const pq = mi_page_queue(heap, size);
+  mi_page_t* page = pq->first;
+  if mi_unlikely(page == NULL || page->capacity >= page->reserved) {
+    // the current page is used up; keep it in the full queue until the heap is destroyed
+    if (page != NULL) { mi_page_to_full(page, pq); }
+    // and continue in the next page (reserved by `mi_heap_reserve`), or in a fresh page
+    page = pq->first;
+    if (page == NULL) { page = mi_page_fresh(heap, pq); }
+  }
+  return page;
+}
+
+static void* mi_heap_monotonic_malloc(mi_heap_t* heap, mi_page_t* page, size_t size, bool zero) {
+  mi_assert_internal(mi_page_is_monotonic(page));
+  mi_assert_internal(page->free == NULL && page->capacity < page->reserved);
+
+  // bump: expose the next block as a singleton free list and allocate it as usual
+  const size_t bsize = mi_page_block_size(page);
+  mi_block_t* const block = (mi_block_t*)(mi_page_start(page) + (page->capacity * bsize));
+  mi_track_mem_undefined(block, sizeof(mi_block_t));
+  mi_block_set_next(page, block, NULL);
+  page->free = block;
+  page->capacity++;
+  mi_heap_stat_increase(heap, page_committed, bsize);
+  return _mi_page_malloc_zero(heap, page, size, zero);
+}
+
+
+/* -----------------------------------------------------------
+  Reserve pages ahead of use so a thread can be "warmed up"
+  before its first allocations.
+----------------------------------------------------------- */
+
+// the blocks in a page that can still be allocated without a fresh page
+static size_t mi_page_available(const mi_page_t* page) {
+  return (mi_page_is_monotonic(page) ? page->reserved - page->capacity : page->reserved - page->used);
+}
+
+int mi_heap_reserve(mi_heap_t* heap, size_t size, size_t nblocks) mi_attr_noexcept {
+  if (heap == NULL || !mi_heap_is_initialized(heap)) return EINVAL;
+  if (heap->thread_id != _mi_thread_id()) return EINVAL;         // only the owning thread can add pages
+  if (size > MI_MEDIUM_OBJ_SIZE_MAX - MI_PADDING_SIZE) return EINVAL;  // large objects always use a fresh page
+  mi_page_queue_t* const pq = mi_page_queue(heap, size + MI_PADDING_SIZE);
+
+  // count what is already available in the queue
+  size_t available = 0;
+  for (mi_page_t* page = pq->first; page != NULL && available < nblocks; page = page->next) {
+    available += mi_page_available(page);
+  }
+
+  // and add fresh pages for the rest; these are committed by the segment and we pre-fault them
+  // here so the first allocations do not take page faults either
+  while (available < nblocks) {
+    mi_page_t* const page = mi_page_fresh(heap, pq);
+    if (page == NULL) return ENOMEM;
+    _mi_os_populate(mi_page_start(page), page->reserved * mi_page_block_size(page));
+    available += mi_page_available(page);
+  }
+  return 0;
+}
+
+
 /* -----------------------------------------------------------
   Users can register a deferred free function called
   when the `free` list is empty. Since the `local_free`
@@ -929,6 +1043,7 @@ static mi_page_t* mi_large_huge_page_alloc(mi_heap_t* heap, size_t size, size_t
       mi_assert_internal(_mi_page_segment(page)->used==1);
       #if MI_HUGE_PAGE_ABANDON
       mi_assert_internal(_mi_page_segment(page)->thread_id==0); // abandoned, not in the huge queue
+      heap->page_bytes -= mi_page_slices_size(page);
       mi_page_set_heap(page, NULL);
       #endif
     }
@@ -989,8 +1104,11 @@ void* _mi_malloc_generic(mi_heap_t* heap, size_t size, bool zero, size_t huge_al
   }
   mi_assert_internal(mi_heap_is_initialized(heap));
 
+  // monotonic heaps bump allocate small and medium objects
+  const bool monotonic = (heap->monotonic && size <= MI_MEDIUM_OBJ_SIZE_MAX && huge_alignment == 0);
+
   // do administrative tasks every N generic mallocs
-  if mi_unlikely(++heap->generic_count >= 100) {
+  if mi_unlikely(!monotonic && ++heap->generic_count >= 100) {
     heap->generic_collect_count += heap->generic_count;
     heap->generic_count = 0;
     // call potential deferred free routines
@@ -1005,13 +1123,24 @@ void* _mi_malloc_generic(mi_heap_t* heap, size_t size, bool zero, size_t huge_al
       heap->generic_collect_count = 0;
       mi_heap_collect(heap, false /* force? */);
     }
+
+    // purge eagerly under memory pressure (and release everything we can when critical)
+    if mi_unlikely(!_mi_purge_thread_is_active() && _mi_os_memory_pressure_check(false)) {
+      mi_heap_collect(heap, _mi_os_memory_pressure() >= 2 /* force? */);
+    }
   }
 
   // find (or allocate) a page of the right size
-  mi_page_t* page = mi_find_page(heap, size, huge_alignment);
+  mi_page_t* page = (monotonic ? mi_heap_monotonic_page(heap, size) : mi_find_page(heap, size, huge_alignment));
   if mi_unlikely(page == NULL) { // first time out of memory, try to collect and retry the allocation once more
     mi_heap_collect(heap, true /* force */);
-    page = mi_find_page(heap, size, huge_alignment);
+    page = (monotonic ? mi_heap_monotonic_page(heap, size) : mi_find_page(heap, size, huge_alignment));
+  }
+  while mi_unlikely(page == NULL && heap->limit_fun != NULL && !mi_heap_page_limit_allows(heap, mi_page_size_estimate(size))) {
+    // over the heap limit: let the limit function release memory and retry
+    if (!heap->limit_fun(heap, heap->page_bytes_limit, heap->page_bytes, size - MI_PADDING_SIZE, heap->limit_arg)) break;
+    mi_heap_collect(heap, true /* force */);
+    page = (monotonic ? mi_heap_monotonic_page(heap, size) : mi_find_page(heap, size, huge_alignment));
   }
 
   if mi_unlikely(page == NULL) { // out of memory
@@ -1019,6 +1148,9 @@ void* _mi_malloc_generic(mi_heap_t* heap, size_t size, bool zero, size_t huge_al
     _mi_error_message(ENOMEM, "unable to allocate memory (%zu bytes)\n", req_size);
     return NULL;
   }
+  if (monotonic) {
+    return mi_heap_monotonic_malloc(heap, page, size, zero);
+  }
 
   mi_assert_internal(mi_page_immediate_available(page));
   mi_assert_internal(mi_page_block_size(page) >= size);
@@ -114,12 +114,91 @@ int _mi_prim_reset(void* addr, size_t size) {
   return 0;
 }
 
+int _mi_prim_purge_ranges(mi_os_range_t* ranges, size_t count, bool decommit, bool* needs_recommit) {
+  int err = 0;
+  *needs_recommit = false;
+  for (size_t i = 0; i < count; i++) {
+    bool recommit = false;
+    const int e = (decommit ? _mi_prim_decommit(ranges[i].start, ranges[i].size, &recommit) : _mi_prim_reset(ranges[i].start, ranges[i].size));
+    if (e != 0 && err == 0) { err = e; }
+    if (recommit) { *needs_recommit = true; }
+  }
+  return err;
+}
+
+int _mi_prim_collapse(void* addr, size_t size) {
+  MI_UNUSED(addr); MI_UNUSED(size);
+  return ENOTSUP;
+}
+
+size_t _mi_prim_thp_size(void) {
+  return 0;
+}
+
+int _mi_prim_populate(void* addr, size_t size) {
+  MI_UNUSED(addr); MI_UNUSED(size);
+  return ENOTSUP;
+}
+
 int _mi_prim_protect(void* addr, size_t size, bool protect) {
   MI_UNUSED(addr); MI_UNUSED(size); MI_UNUSED(protect);
   return 0;
 }
 
 
+//---------------------------------------------
+// Remap
+//---------------------------------------------
+
+int _mi_prim_remap(void* addr, size_t size, size_t newsize, size_t alignment, void** newaddr) {
+  MI_UNUSED(addr); MI_UNUSED(size); MI_UNUSED(newsize); MI_UNUSED(alignment);
+  *newaddr = NULL;
+  return ENOTSUP;
+}
+
+//---------------------------------------------
+// Background thread
+//---------------------------------------------
+
+bool _mi_prim_bgthread_start(mi_msecs_t (*fun)(void)) {
+  MI_UNUSED(fun);
+  return false;
+}
+
+bool _mi_prim_bgthread_wakeup(void) {
+  return false;
+}
+
+void _mi_prim_bgthread_stop(void) {
+  // nothing
+}
+
+bool _mi_prim_bgthread_is_running(void) {
+  return false;
+}
+
+size_t _mi_prim_run_parallel(size_t nthreads, void (*fun)(size_t i, void* arg), void* arg) {
+  MI_UNUSED(nthreads);
+  fun(0, arg);
+  return 1;
+}
+
+size_t _mi_prim_capture_stack(void** frames, size_t max_frames, size_t skip) {
+  MI_UNUSED(frames); MI_UNUSED(max_frames); MI_UNUSED(skip);
+  return 0;
+}
+
+//---------------------------------------------
+// Memory limits and pressure
+//---------------------------------------------
+
+bool _mi_prim_memory_pressure(mi_memory_pressure_t* mp) {
+  MI_UNUSED(mp);
+  return false;
+}
+
+
+
 //---------------------------------------------
 // Huge pages and NUMA nodes
 //---------------------------------------------
@@ -131,6 +210,11 @@ int _mi_prim_alloc_huge_os_pages(void* hint_addr, size_t size, int numa_node, bo
   return ENOSYS;
 }
 
+int _mi_prim_numa_bind(void* addr, size_t size, int numa_node) {
+  MI_UNUSED(addr); MI_UNUSED(size); MI_UNUSED(numa_node);
+  return ENOTSUP;
+}
+
 size_t _mi_prim_numa_node(void) {
   return 0;
 }
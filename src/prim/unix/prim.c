@@ -63,6 +63,10 @@ terms of the MIT license. A copy of the license can be found in the file
   #include <sys/syscall.h>
 #endif
 
+#if defined(__linux__) && defined(MI_HAS_SYSCALL_H) && defined(SYS_mremap) && defined(MREMAP_MAYMOVE) && defined(MREMAP_FIXED)
+  #define MI_HAS_MREMAP
+#endif
+
 #if !defined(MADV_DONTNEED) && defined(POSIX_MADV_DONTNEED)  // QNX
 #define MADV_DONTNEED  POSIX_MADV_DONTNEED
 #endif
@@ -160,13 +164,16 @@ void _mi_prim_mem_init( mi_os_mem_config_t* config )
   config->has_overcommit = unix_detect_overcommit();
   config->has_partial_free = true;    // mmap can free in parts
   config->has_virtual_reserve = true; // todo: check if this true for NetBSD?  (for anonymous mmap with PROT_NONE)
+  #if defined(MI_HAS_MREMAP)
+  config->has_remap = true;           // mremap can resize and move mappings
+  #endif
 
   // disable transparent huge pages for this process?
   #if (defined(__linux__) || defined(__ANDROID__)) && defined(PR_GET_THP_DISABLE)
   #if defined(MI_NO_THP)
   if (true)
   #else
-  if (!mi_option_is_enabled(mi_option_allow_large_os_pages)) // disable THP also if large OS pages are not allowed in the options
+  if (!mi_option_is_enabled(mi_option_allow_large_os_pages) && !mi_option_is_enabled(mi_option_thp_mode)) // disable THP also if large OS pages are not allowed in the options
   #endif
   {
     int val = 0;
@@ -360,7 +367,9 @@ static void* unix_mmap(void* addr, size_t size, size_t try_alignment, int protec
       // in that case -- in particular for our large regions (in `memory.c`).
       // However, some systems only allow THP if called with explicit `madvise`, so
       // when large OS pages are enabled for mimalloc, we call `madvise` anyways.
-      if (allow_large && _mi_os_use_large_page(size, try_alignment)) {
+      // In THP mode we always advise huge pages for segment aligned memory.
+      if ((allow_large && _mi_os_use_large_page(size, try_alignment)) ||
+          (mi_option_is_enabled(mi_option_thp_mode) && (size % (2*MI_MiB)) == 0 && (try_alignment % (2*MI_MiB)) == 0)) {
         if (unix_madvise(p, size, MADV_HUGEPAGE) == 0) {
           // *is_large = true; // possibly
         };
@@ -465,6 +474,125 @@ int _mi_prim_reset(void* start, size_t size) {
   return err;
 }
 
+#if !MI_DEBUG && !MI_SECURE
+#if defined(__linux__) && defined(MI_HAS_SYSCALL_H) && defined(SYS_process_madvise)
+#include <sys/uio.h>  // struct iovec
+#ifndef PIDFD_SELF
+#define PIDFD_SELF  (-10000)
+#endif
+
+// Advise many ranges with a single `process_madvise` call on our own process (Linux 6.13+
+// allows any advice when targeting the calling process). Returns false if not supported.
+static bool unix_process_madvise(mi_os_range_t* ranges, size_t count, int advice) {
+  static _Atomic(size_t) supported = MI_ATOMIC_VAR_INIT(1);
+  if (count <= 1 || count > 1024 || mi_atomic_load_relaxed(&supported) == 0) return false;
+  struct iovec iov[64];
+  size_t total = 0;
+  for (size_t i = 0; i < count; i += 64) {
+    const size_t n = (count - i < 64 ? count - i : 64);
+    size_t expected = 0;
+    for (size_t j = 0; j < n; j++) {
+      iov[j].iov_base = ranges[i+j].start;
+      iov[j].iov_len  = ranges[i+j].size;
+      expected += ranges[i+j].size;
+    }
+    const long res = syscall(SYS_process_madvise, PIDFD_SELF, iov, n, advice, 0);
+    if (res < 0 || (size_t)res != expected) {
+      if (res < 0 && (errno == EINVAL || errno == EBADF || errno == ENOSYS || errno == EPERM)) {
+        mi_atomic_store_release(&supported, (size_t)0);  // not supported on this kernel; use madvise from now on
+      }
+      if (total == 0) return false;
+      // partially done: advise the remaining ranges one by one
+      for (size_t j = i; j < count; j++) { unix_madvise(ranges[j].start, ranges[j].size, advice); }
+      return true;
+    }
+    total += (size_t)res;
+  }
+  return true;
+}
+#else
+static bool unix_process_madvise(mi_os_range_t* ranges, size_t count, int advice) {
+  MI_UNUSED(ranges); MI_UNUSED(count); MI_UNUSED(advice);
+  return false;
+}
+#endif
+#endif
+
+int _mi_prim_purge_ranges(mi_os_range_t* ranges, size_t count, bool decommit, bool* needs_recommit) {
+  #if !MI_DEBUG && !MI_SECURE
+  // decommit and reset are both a plain `madvise` so we can submit all ranges at once
+  #if defined(MADV_FREE)
+  const int advice = (decommit ? MADV_DONTNEED : MADV_FREE);
+  #else
+  const int advice = MADV_DONTNEED;
+  #endif
+  *needs_recommit = false;
+  if (unix_process_madvise(ranges, count, advice)) return 0;
+  #endif
+  int err = 0;
+  *needs_recommit = false;
+  for (size_t i = 0; i < count; i++) {
+    bool recommit = false;
+    const int e = (decommit ? _mi_prim_decommit(ranges[i].start, ranges[i].size, &recommit) : _mi_prim_reset(ranges[i].start, ranges[i].size));
+    if (e != 0 && err == 0) { err = e; }
+    if (recommit) { *needs_recommit = true; }
+  }
+  return err;
+}
+
+int _mi_prim_collapse(void* start, size_t size) {
+  #if defined(__linux__)
+  #if !defined(MADV_COLLAPSE)
+  #define MADV_COLLAPSE  25
+  #endif
+  return unix_madvise(start, size, MADV_COLLAPSE);
+  #else
+  MI_UNUSED(start); MI_UNUSED(size);
+  return ENOTSUP;
+  #endif
+}
+
+int _mi_prim_populate(void* start, size_t size) {
+  #if defined(__linux__)
+  #if !defined(MADV_POPULATE_WRITE)
+  #define MADV_POPULATE_WRITE  23
+  #endif
+  return unix_madvise(start, size, MADV_POPULATE_WRITE);
+  #else
+  MI_UNUSED(start); MI_UNUSED(size);
+  return ENOTSUP;
+  #endif
+}
+
+size_t _mi_prim_thp_size(void) {
+  #if defined(__linux__)
+  // sum the `AnonHugePages: N kB` entries of the process
+  const int fd = mi_prim_open("/proc/self/smaps_rollup", O_RDONLY);
+  if (fd < 0) return 0;
+  char buf[1024];
+  const ssize_t n = mi_prim_read(fd, buf, sizeof(buf) - 1);
+  mi_prim_close(fd);
+  if (n <= 0) return 0;
+  buf[n] = 0;
+  size_t kib = 0;
+  const char* const key = "AnonHugePages:";
+  const size_t keylen = _mi_strlen(key);
+  for (const char* line = buf; *line != 0; ) {
+    if (_mi_strnicmp(line, key, keylen) == 0) {
+      const char* s = line + keylen;
+      while (*s == ' ') { s++; }
+      while (*s >= '0' && *s <= '9') { kib = 10*kib + (size_t)(*s - '0'); s++; }
+      break;
+    }
+    while (*line != 0 && *line != '\n') { line++; }
+    if (*line == '\n') { line++; }
+  }
+  return kib * MI_KiB;
+  #else
+  return 0;
+  #endif
+}
+
 int _mi_prim_protect(void* start, size_t size, bool protect) {
   int err = mprotect(start, size, protect ? PROT_NONE : (PROT_READ | PROT_WRITE));
   if (err != 0) { err = errno; }
@@ -474,6 +602,58 @@ int _mi_prim_protect(void* start, size_t size, bool protect) {
 
 
 
+//---------------------------------------------
+// Remap
+//---------------------------------------------
+
+#if defined(MI_HAS_MREMAP)
+
+static void* unix_mremap(void* addr, size_t size, size_t newsize, int flags, void* newaddr) {
+  return (void*)syscall(SYS_mremap, addr, size, newsize, flags, newaddr);
+}
+
+int _mi_prim_remap(void* addr, size_t size, size_t newsize, size_t alignment, void** newaddr) {
+  mi_assert_internal(addr != NULL && _mi_is_aligned(addr, alignment));
+  *newaddr = NULL;
+  // first try to resize in place (always succeeds when shrinking)
+  void* p = unix_mremap(addr, size, newsize, 0, NULL);
+  if (p == addr) {
+    *newaddr = p;
+    return 0;
+  }
+  // otherwise reserve an aligned range and move the mapping there
+  if (newsize >= SIZE_MAX - alignment) return EOVERFLOW;
+  const size_t over_size = newsize + alignment;
+  void* const reserved = mmap(NULL, over_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (reserved == MAP_FAILED) return errno;
+  uint8_t* const target = (uint8_t*)mi_align_up_ptr(reserved, alignment);
+  p = unix_mremap(addr, size, newsize, MREMAP_MAYMOVE | MREMAP_FIXED, target);
+  if (p == MAP_FAILED) {
+    const int err = errno;
+    munmap(reserved, over_size);
+    return err;
+  }
+  mi_assert_internal(p == target);
+  // and unmap the parts of the reservation around it
+  const size_t pre_size  = (size_t)(target - (uint8_t*)reserved);
+  const size_t post_size = over_size - pre_size - newsize;
+  if (pre_size > 0)  { munmap(reserved, pre_size); }
+  if (post_size > 0) { munmap(target + newsize, post_size); }
+  *newaddr = p;
+  return 0;
+}
+
+#else
+
+int _mi_prim_remap(void* addr, size_t size, size_t newsize, size_t alignment, void** newaddr) {
+  MI_UNUSED(addr); MI_UNUSED(size); MI_UNUSED(newsize); MI_UNUSED(alignment);
+  *newaddr = NULL;
+  return ENOTSUP;
+}
+
+#endif
+
+
 //---------------------------------------------
 // Huge page allocation
 //---------------------------------------------
@@ -513,6 +693,13 @@ int _mi_prim_alloc_huge_os_pages(void* hint_addr, size_t size, int numa_node, bo
   return (*addr != NULL ? 0 : errno);
 }
 
+int _mi_prim_numa_bind(void* addr, size_t size, int numa_node) {
+  if (numa_node < 0 || numa_node >= 8*MI_INTPTR_SIZE) return EINVAL;  // at most 64 nodes
+  unsigned long numa_mask = (1UL << numa_node);
+  long err = mi_prim_mbind(addr, size, MPOL_PREFERRED, &numa_mask, 8*MI_INTPTR_SIZE, 0);
+  return (err == 0 ? 0 : errno);
+}
+
 #else
 
 int _mi_prim_alloc_huge_os_pages(void* hint_addr, size_t size, int numa_node, bool* is_zero, void** addr) {
@@ -522,6 +709,11 @@ int _mi_prim_alloc_huge_os_pages(void* hint_addr, size_t size, int numa_node, bo
   return ENOMEM;
 }
 
+int _mi_prim_numa_bind(void* addr, size_t size, int numa_node) {
+  MI_UNUSED(addr); MI_UNUSED(size); MI_UNUSED(numa_node);
+  return ENOTSUP;
+}
+
 #endif
 
 //---------------------------------------------
@@ -600,6 +792,318 @@ size_t _mi_prim_numa_node_count(void) {
 
 #endif
 
+
+//---------------------------------------------
+// Background thread
+//---------------------------------------------
+
+#if defined(MI_USE_PTHREADS)
+#include <time.h>   // clock_gettime
+
+static pthread_t        mi_bgthread;
+static pthread_mutex_t  mi_bgthread_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   mi_bgthread_cond  = PTHREAD_COND_INITIALIZER;
+static mi_msecs_t     (*mi_bgthread_fun)(void);
+static bool             mi_bgthread_running;
+static bool             mi_bgthread_stop;     // (protected by the mutex)
+static bool             mi_bgthread_woken;    // woken up while calling `mi_bgthread_fun` (protected by the mutex)
+static _Atomic(size_t)  mi_bgthread_exited;   // the thread exited by itself (but is not yet joined)
+
+static void* mi_bgthread_entry(void* arg) {
+  MI_UNUSED(arg);
+  pthread_mutex_lock(&mi_bgthread_mutex);
+  while (!mi_bgthread_stop) {
+    mi_bgthread_woken = false;
+    pthread_mutex_unlock(&mi_bgthread_mutex);
+    mi_msecs_t wait = mi_bgthread_fun();
+    pthread_mutex_lock(&mi_bgthread_mutex);
+    if (mi_bgthread_stop || mi_bgthread_woken) continue;
+    if (wait < 0) {
+      // nothing left to do; decided under the lock so a concurrent wakeup either runs us again or sees that we exited
+      mi_atomic_store_release(&mi_bgthread_exited, (size_t)1);
+      break;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    if (wait == 0) { wait = 1; }
+    ts.tv_sec  += (time_t)(wait / 1000);
+    ts.tv_nsec += (long)((wait % 1000) * 1000000);
+    if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+    pthread_cond_timedwait(&mi_bgthread_cond, &mi_bgthread_mutex, &ts);
+  }
+  pthread_mutex_unlock(&mi_bgthread_mutex);
+  return NULL;
+}
+
+static void mi_bgthread_atfork_child(void) {
+  // threads are not duplicated on fork
+  mi_bgthread_running = false;
+}
+
+bool _mi_prim_bgthread_start(mi_msecs_t (*fun)(void)) {
+  if (mi_bgthread_running) {
+    if (mi_atomic_load_acquire(&mi_bgthread_exited) == 0) return false;
+    pthread_join(mi_bgthread, NULL);  // reap the thread that exited by itself
+    mi_bgthread_running = false;
+  }
+  static bool atfork_registered = false;
+  if (!atfork_registered) {
+    atfork_registered = true;
+    pthread_atfork(NULL, NULL, &mi_bgthread_atfork_child);
+  }
+  mi_bgthread_fun = fun;
+  mi_bgthread_stop = false;
+  mi_atomic_store_release(&mi_bgthread_exited, (size_t)0);
+  if (pthread_create(&mi_bgthread, NULL, &mi_bgthread_entry, NULL) != 0) return false;
+  mi_bgthread_running = true;
+  return true;
+}
+
+bool _mi_prim_bgthread_wakeup(void) {
+  if (!mi_bgthread_running) return false;
+  pthread_mutex_lock(&mi_bgthread_mutex);
+  const bool alive = (mi_atomic_load_relaxed(&mi_bgthread_exited) == 0);
+  if (alive) {
+    mi_bgthread_woken = true;
+    pthread_cond_signal(&mi_bgthread_cond);
+  }
+  pthread_mutex_unlock(&mi_bgthread_mutex);
+  return alive;
+}
+
+void _mi_prim_bgthread_stop(void) {
+  if (!mi_bgthread_running) return;
+  pthread_mutex_lock(&mi_bgthread_mutex);
+  mi_bgthread_stop = true;
+  pthread_cond_signal(&mi_bgthread_cond);
+  pthread_mutex_unlock(&mi_bgthread_mutex);
+  pthread_join(mi_bgthread, NULL);
+  mi_bgthread_running = false;
+}
+
+bool _mi_prim_bgthread_is_running(void) {
+  return (mi_bgthread_running && mi_atomic_load_relaxed(&mi_bgthread_exited) == 0);
+}
+
+#else
+
+bool _mi_prim_bgthread_start(mi_msecs_t (*fun)(void)) {
+  MI_UNUSED(fun);
+  return false;
+}
+
+bool _mi_prim_bgthread_wakeup(void) {
+  return false;
+}
+
+void _mi_prim_bgthread_stop(void) {
+  // nothing
+}
+
+bool _mi_prim_bgthread_is_running(void) {
+  return false;
+}
+
+#endif
+
+//---------------------------------------------
+// Run in parallel
+//---------------------------------------------
+
+#define MI_PARALLEL_MAX  (64)
+
+#if defined(MI_USE_PTHREADS)
+
+typedef struct mi_parallel_task_s {
+  void (*fun)(size_t i, void* arg);
+  void*  arg;
+  size_t i;
+} mi_parallel_task_t;
+
+static void* mi_parallel_entry(void* arg) {
+  mi_parallel_task_t* task = (mi_parallel_task_t*)arg;
+  task->fun(task->i, task->arg);
+  return NULL;
+}
+
+size_t _mi_prim_run_parallel(size_t nthreads, void (*fun)(size_t i, void* arg), void* arg) {
+  if (nthreads > MI_PARALLEL_MAX) { nthreads = MI_PARALLEL_MAX; }
+  pthread_t threads[MI_PARALLEL_MAX];
+  mi_parallel_task_t tasks[MI_PARALLEL_MAX];
+  size_t started = 0;
+  for (size_t i = 1; i < nthreads; i++) {
+    tasks[started].fun = fun;
+    tasks[started].arg = arg;
+    tasks[started].i = i;
+    if (pthread_create(&threads[started], NULL, &mi_parallel_entry, &tasks[started]) != 0) break;
+    started++;
+  }
+  fun(0, arg);
+  for (size_t i = 0; i < started; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  return (started + 1);
+}
+
+#else
+
+size_t _mi_prim_run_parallel(size_t nthreads, void (*fun)(size_t i, void* arg), void* arg) {
+  MI_UNUSED(nthreads);
+  fun(0, arg);
+  return 1;
+}
+
+#endif
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#include <execinfo.h>  // backtrace
+
+size_t _mi_prim_capture_stack(void** frames, size_t max_frames, size_t skip) {
+  // note: the first call may allocate (as glibc loads the unwinder) so the caller should prevent recursion
+  void* buf[128];
+  skip++;  // skip this function as well
+  if (max_frames + skip > 128) { max_frames = 128 - skip; }
+  const int n = backtrace(buf, (int)(max_frames + skip));
+  if (n <= (int)skip) return 0;
+  const size_t count = (size_t)n - skip;
+  _mi_memcpy(frames, buf + skip, count * sizeof(void*));
+  return count;
+}
+
+#else
+
+size_t _mi_prim_capture_stack(void** frames, size_t max_frames, size_t skip) {
+  MI_UNUSED(frames); MI_UNUSED(max_frames); MI_UNUSED(skip);
+  return 0;
+}
+
+#endif
+
+
+//---------------------------------------------
+// Memory limits and pressure
+//---------------------------------------------
+
+#if defined(__linux__)
+
+// Read a small file as a zero terminated string. Returns false on failure.
+static bool mi_prim_read_file(const char* fname, char* buf, size_t bufsize) {
+  const int fd = mi_prim_open(fname, O_RDONLY);
+  if (fd < 0) return false;
+  const ssize_t n = mi_prim_read(fd, buf, bufsize - 1);
+  mi_prim_close(fd);
+  if (n <= 0) return false;
+  buf[n] = 0;
+  return true;
+}
+
+// Parse a decimal number with up to 2 fractional digits (like "1.25"), in hundredths.
+static const char* mi_prim_parse_hundredths(const char* s, size_t* value) {
+  size_t v = 0;
+  while (*s >= '0' && *s <= '9') { v = 10*v + (size_t)(*s - '0'); s++; }
+  v *= 100;
+  if (*s == '.') {
+    s++;
+    if (*s >= '0' && *s <= '9') { v += 10*(size_t)(*s - '0'); s++; }
+    if (*s >= '0' && *s <= '9') { v += (size_t)(*s - '0'); s++; }
+  }
+  *value = v;
+  return s;
+}
+
+// The cgroup v2 directory of this process (like `/sys/fs/cgroup/system.slice/foo.service`)
+#define MI_CGROUP_ROOT  "/sys/fs/cgroup"
+static char mi_cgroup_dir[256];
+
+static bool mi_cgroup_init(void) {
+  static bool initialized = false;
+  if (initialized) return (mi_cgroup_dir[0] != 0);
+  initialized = true;
+  // the cgroup v2 entry in `/proc/self/cgroup` looks like `0::/path`
+  char buf[512];
+  if (!mi_prim_read_file("/proc/self/cgroup", buf, sizeof(buf))) return false;
+  const char* line = buf;
+  while (line[0] != 0 && !(line[0] == '0' && line[1] == ':' && line[2] == ':')) {
+    while (*line != 0 && *line != '\n') { line++; }
+    if (*line == '\n') { line++; }
+  }
+  if (line[0] == 0) return false;
+  char path[256];
+  size_t len = 0;
+  line += 3;
+  while (line[len] != 0 && line[len] != '\n' && len < sizeof(path) - 1) { path[len] = line[len]; len++; }
+  path[len] = 0;
+  _mi_strlcpy(mi_cgroup_dir, MI_CGROUP_ROOT, sizeof(mi_cgroup_dir));
+  if (len > 1) { _mi_strlcat(mi_cgroup_dir, path, sizeof(mi_cgroup_dir)); }
+  return true;
+}
+
+// Read a cgroup memory limit file (like `memory.max`); returns 0 if unlimited
+static size_t mi_cgroup_read_limit(const char* dir, const char* fname) {
+  char path[320];
+  char buf[64];
+  _mi_strlcpy(path, dir, sizeof(path));
+  _mi_strlcat(path, fname, sizeof(path));
+  if (!mi_prim_read_file(path, buf, sizeof(buf))) return 0;
+  if (buf[0] < '0' || buf[0] > '9') return 0;  // "max"
+  size_t limit = 0;
+  for (const char* s = buf; *s >= '0' && *s <= '9'; s++) { limit = 10*limit + (size_t)(*s - '0'); }
+  return limit;
+}
+
+// The smallest `memory.high` or `memory.max` of our cgroup and its parents
+static size_t mi_cgroup_memory_limit(void) {
+  char dir[256];
+  _mi_strlcpy(dir, mi_cgroup_dir, sizeof(dir));
+  size_t limit = 0;
+  const size_t root_len = sizeof(MI_CGROUP_ROOT) - 1;  // `_mi_strlen(MI_CGROUP_ROOT)`
+  size_t len = _mi_strlen(dir);
+  while (len > root_len) {  // up to (but not including) the cgroup root
+    const size_t high = mi_cgroup_read_limit(dir, "/memory.high");
+    const size_t max  = mi_cgroup_read_limit(dir, "/memory.max");
+    if (high > 0 && (limit == 0 || high < limit)) { limit = high; }
+    if (max > 0 && (limit == 0 || max < limit))   { limit = max; }
+    while (len > 0 && dir[len-1] != '/') { len--; }
+    if (len > 0) { len--; }
+    dir[len] = 0;
+  }
+  return limit;
+}
+
+bool _mi_prim_memory_pressure(mi_memory_pressure_t* mp) {
+  mp->limit = 0;
+  mp->stall = 0;
+  const bool has_cgroup = mi_cgroup_init();
+  if (has_cgroup) {
+    mp->limit = mi_cgroup_memory_limit();
+  }
+  // pressure stall information: `some avg10=1.25 avg60=...`
+  char buf[256];
+  bool has_psi = false;
+  if (has_cgroup) {
+    char path[320];
+    _mi_strlcpy(path, mi_cgroup_dir, sizeof(path));
+    _mi_strlcat(path, "/memory.pressure", sizeof(path));
+    has_psi = mi_prim_read_file(path, buf, sizeof(buf));
+  }
+  if (!has_psi) {
+    has_psi = mi_prim_read_file("/proc/pressure/memory", buf, sizeof(buf));
+  }
+  if (has_psi && _mi_strnlen(buf, 16) > 11 && _mi_strnicmp(buf, "some avg10=", 11) == 0) {
+    mi_prim_parse_hundredths(buf + 11, &mp->stall);
+  }
+  return (has_cgroup || has_psi);
+}
+
+#else
+
+bool _mi_prim_memory_pressure(mi_memory_pressure_t* mp) {
+  MI_UNUSED(mp);
+  return false;
+}
+
+#endif
+
 // ----------------------------------------------------------------
 // Clock
 // ----------------------------------------------------------------
@@ -352,6 +352,32 @@ int _mi_prim_reset(void* addr, size_t size) {
   return (p != NULL ? 0 : (int)GetLastError());
 }
 
+int _mi_prim_purge_ranges(mi_os_range_t* ranges, size_t count, bool decommit, bool* needs_recommit) {
+  int err = 0;
+  *needs_recommit = false;
+  for (size_t i = 0; i < count; i++) {
+    bool recommit = false;
+    const int e = (decommit ? _mi_prim_decommit(ranges[i].start, ranges[i].size, &recommit) : _mi_prim_reset(ranges[i].start, ranges[i].size));
+    if (e != 0 && err == 0) { err = e; }
+    if (recommit) { *needs_recommit = true; }
+  }
+  return err;
+}
+
+int _mi_prim_collapse(void* addr, size_t size) {
+  MI_UNUSED(addr); MI_UNUSED(size);
+  return ENOTSUP;
+}
+
+size_t _mi_prim_thp_size(void) {
+  return 0;
+}
+
+int _mi_prim_populate(void* addr, size_t size) {
+  MI_UNUSED(addr); MI_UNUSED(size);
+  return ENOTSUP;  // `PrefetchVirtualMemory` does not populate fresh (demand zero) pages
+}
+
 int _mi_prim_protect(void* addr, size_t size, bool protect) {
   DWORD oldprotect = 0;
   BOOL ok = VirtualProtect(addr, size, protect ? PAGE_NOACCESS : PAGE_READWRITE, &oldprotect);
@@ -359,6 +385,153 @@ int _mi_prim_protect(void* addr, size_t size, bool protect) {
 }
 
 
+//---------------------------------------------
+// Remap
+//---------------------------------------------
+
+int _mi_prim_remap(void* addr, size_t size, size_t newsize, size_t alignment, void** newaddr) {
+  MI_UNUSED(addr); MI_UNUSED(size); MI_UNUSED(newsize); MI_UNUSED(alignment);
+  *newaddr = NULL;
+  return ENOTSUP;
+}
+
+//---------------------------------------------
+// Background thread
+//---------------------------------------------
+
+static HANDLE mi_bgthread;
+static HANDLE mi_bgthread_event;
+static mi_msecs_t (*mi_bgthread_fun)(void);
+static volatile LONG mi_bgthread_stop;
+static SRWLOCK mi_bgthread_lock = SRWLOCK_INIT;
+static bool mi_bgthread_woken;          // woken up while calling `mi_bgthread_fun` (protected by the lock)
+static volatile LONG mi_bgthread_exited; // the thread exited by itself (but its handle is not yet closed)
+
+static DWORD WINAPI mi_bgthread_entry(LPVOID arg) {
+  MI_UNUSED(arg);
+  while (mi_bgthread_stop == 0) {
+    AcquireSRWLockExclusive(&mi_bgthread_lock);
+    mi_bgthread_woken = false;
+    ReleaseSRWLockExclusive(&mi_bgthread_lock);
+    const mi_msecs_t wait = mi_bgthread_fun();
+    AcquireSRWLockExclusive(&mi_bgthread_lock);
+    const bool done = (wait < 0 && !mi_bgthread_woken);
+    if (done) { InterlockedExchange(&mi_bgthread_exited, 1); }
+    ReleaseSRWLockExclusive(&mi_bgthread_lock);
+    if (done) break;  // nothing left to do
+    // (a wakeup while calling `mi_bgthread_fun` left the event set so we continue right away)
+    if (mi_bgthread_stop == 0) { WaitForSingleObject(mi_bgthread_event, (wait <= 0 ? 1 : (DWORD)wait)); }
+  }
+  return 0;
+}
+
+static void mi_bgthread_close(void) {
+  CloseHandle(mi_bgthread);
+  CloseHandle(mi_bgthread_event);
+  mi_bgthread = NULL;
+  mi_bgthread_event = NULL;
+}
+
+bool _mi_prim_bgthread_start(mi_msecs_t (*fun)(void)) {
+  if (mi_bgthread != NULL) {
+    if (mi_bgthread_exited == 0) return false;
+    WaitForSingleObject(mi_bgthread, INFINITE);  // reap the thread that exited by itself
+    mi_bgthread_close();
+  }
+  mi_bgthread_exited = 0;
+  mi_bgthread_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+  if (mi_bgthread_event == NULL) return false;
+  mi_bgthread_fun = fun;
+  mi_bgthread_stop = 0;
+  mi_bgthread = CreateThread(NULL, 64*MI_KiB, &mi_bgthread_entry, NULL, 0, NULL);
+  if (mi_bgthread == NULL) {
+    CloseHandle(mi_bgthread_event);
+    mi_bgthread_event = NULL;
+    return false;
+  }
+  return true;
+}
+
+void _mi_prim_bgthread_stop(void) {
+  if (mi_bgthread == NULL) return;
+  InterlockedExchange(&mi_bgthread_stop, 1);
+  SetEvent(mi_bgthread_event);
+  // bounded wait as we may hold the loader lock during process detach
+  WaitForSingleObject(mi_bgthread, 1000);
+  mi_bgthread_close();
+}
+
+bool _mi_prim_bgthread_wakeup(void) {
+  if (mi_bgthread == NULL) return false;
+  AcquireSRWLockExclusive(&mi_bgthread_lock);
+  const bool alive = (mi_bgthread_exited == 0);
+  if (alive) {
+    mi_bgthread_woken = true;
+    SetEvent(mi_bgthread_event);
+  }
+  ReleaseSRWLockExclusive(&mi_bgthread_lock);
+  return alive;
+}
+
+bool _mi_prim_bgthread_is_running(void) {
+  return (mi_bgthread != NULL && mi_bgthread_exited == 0);
+}
+
+//---------------------------------------------
+// Run in parallel
+//---------------------------------------------
+
+#define MI_PARALLEL_MAX  (64)
+
+typedef struct mi_parallel_task_s {
+  void (*fun)(size_t i, void* arg);
+  void*  arg;
+  size_t i;
+} mi_parallel_task_t;
+
+static DWORD WINAPI mi_parallel_entry(LPVOID arg) {
+  mi_parallel_task_t* task = (mi_parallel_task_t*)arg;
+  task->fun(task->i, task->arg);
+  return 0;
+}
+
+size_t _mi_prim_run_parallel(size_t nthreads, void (*fun)(size_t i, void* arg), void* arg) {
+  if (nthreads > MI_PARALLEL_MAX) { nthreads = MI_PARALLEL_MAX; }
+  HANDLE threads[MI_PARALLEL_MAX];
+  mi_parallel_task_t tasks[MI_PARALLEL_MAX];
+  size_t started = 0;
+  for (size_t i = 1; i < nthreads; i++) {
+    tasks[started].fun = fun;
+    tasks[started].arg = arg;
+    tasks[started].i = i;
+    threads[started] = CreateThread(NULL, 64*MI_KiB, &mi_parallel_entry, &tasks[started], 0, NULL);
+    if (threads[started] == NULL) break;
+    started++;
+  }
+  fun(0, arg);
+  for (size_t i = 0; i < started; i++) {
+    WaitForSingleObject(threads[i], INFINITE);
+    CloseHandle(threads[i]);
+  }
+  return (started + 1);
+}
+
+size_t _mi_prim_capture_stack(void** frames, size_t max_frames, size_t skip) {
+  if (max_frames > 62) { max_frames = 62; }  // limit on Windows XP/2003
+  return (size_t)CaptureStackBackTrace((DWORD)(skip + 1), (DWORD)max_frames, frames, NULL);
+}
+
+//---------------------------------------------
+// Memory limits and pressure
+//---------------------------------------------
+
+bool _mi_prim_memory_pressure(mi_memory_pressure_t* mp) {
+  MI_UNUSED(mp);
+  return false;
+}
+
+
+
 //---------------------------------------------
 // Huge page allocation
 //---------------------------------------------
@@ -410,6 +583,11 @@ int _mi_prim_alloc_huge_os_pages(void* hint_addr, size_t size, int numa_node, bo
   return (*addr != NULL ? 0 : (int)GetLastError());
 }
 
+int _mi_prim_numa_bind(void* addr, size_t size, int numa_node) {
+  MI_UNUSED(addr); MI_UNUSED(size); MI_UNUSED(numa_node);
+  return ENOTSUP;
+}
+
 
 //---------------------------------------------
 // Numa nodes
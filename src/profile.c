@@ -0,0 +1,450 @@
+/* ----------------------------------------------------------------------------
+Copyright (c) 2025, Microsoft Research, Daan Leijen
+This is free software; you can redistribute it and/or modify it under the
+terms of the MIT license. A copy of the license can be found in the file
+"LICENSE" at the root of this distribution.
+-----------------------------------------------------------------------------*/
+#include "mimalloc.h"
+#include "mimalloc/internal.h"
+#include "mimalloc/atomic.h"
+#include "mimalloc/prim.h"
+
+#include <stdio.h>    // fopen, fprintf
+#include <string.h>   // memcmp
+#include <errno.h>
+
+/* -----------------------------------------------------------
+  Sampling heap profiler (when building with MI_PROFILE=1)
+
+  Each heap counts down the allocated bytes until the next sample
+  (see `internal.h:mi_heap_profile_sample`) where the distance between
+  samples is drawn from an exponential distribution with a mean of
+  `mi_option_profile_sample_rate` bytes, such that every allocated byte
+  has the same chance of being sampled.
+
+  For a sampled block we record its size, the time, and the stack trace
+  of the allocation in a side table, and mark its page as `has_sampled`.
+  All frees in such page take the generic path where the block is
+  removed from the table again. Most blocks in such page are not
+  sampled though, so we first look up the block without taking the lock.
+
+  The live and cumulative profiles can be written with `mi_profile_dump`.
+----------------------------------------------------------- */
+
+#if MI_PROFILE
+
+#define MI_PROFILE_MAX_FRAMES   (32)
+#define MI_PROFILE_STACKS       (4096)            // max distinct stack traces (power of 2)
+#define MI_PROFILE_SAMPLES      (64*1024)         // sample table size (power of 2)
+#define MI_PROFILE_SLOT_FREE    ((uintptr_t)0)    // a free slot in the sample table
+#define MI_PROFILE_SLOT_DELETED ((uintptr_t)1)    // a deleted slot (so lookups can continue past it)
+
+typedef struct mi_profile_stack_s {
+  size_t      hash;                             // 0 if unused
+  size_t      depth;
+  size_t      alloc_count;                      // total sampled allocations
+  size_t      alloc_bytes;                      // total sampled bytes
+  double      alloc_estimate;                   // estimated total allocated bytes
+  void*       frames[MI_PROFILE_MAX_FRAMES];    // return addresses (innermost first)
+} mi_profile_stack_t;
+
+typedef struct mi_profile_sample_s {
+  _Atomic(uintptr_t) block;                     // the sampled block (or a free/deleted slot)
+  size_t      size;                             // requested size
+  size_t      rate;                             // sample rate of the heap at the time
+  size_t      stack;                            // index in the `stacks` table
+  mi_msecs_t  time;                             // time of allocation
+} mi_profile_sample_t;
+
+typedef struct mi_profile_s {
+  mi_memid_t            memid;
+  size_t                stack_count;
+  size_t                sample_count;           // live samples
+  size_t                sample_used;            // live and deleted slots in the current sample table
+  size_t                dropped;                // samples dropped as the tables were full
+  _Atomic(size_t)       generation;             // odd while the sample table is rebuilt
+  _Atomic(mi_profile_sample_t*) samples;        // current sample table (one of `sample_tables`)
+  mi_profile_stack_t    stacks[MI_PROFILE_STACKS];
+  mi_profile_sample_t   sample_tables[2][MI_PROFILE_SAMPLES];
+} mi_profile_t;
+
+static mi_lock_t mi_profile_lock;
+static _Atomic(mi_profile_t*) mi_profile;    // allocated on the first sample
+static mi_decl_thread bool mi_profile_recurse = false;
+
+void _mi_profile_init(void) {
+  mi_lock_init(&mi_profile_lock);
+}
+
+// The distance to the next sample: exponentially distributed with mean `rate` as `-ln(u)*rate`.
+// We approximate `log2(u)` using the exponent and a quadratic fit on the mantissa which is
+// precise enough for sampling.
+static size_t mi_profile_next_interval(mi_heap_t* heap) {
+  const size_t rate = heap->profile_sample_rate;
+  if (rate == 0) return SIZE_MAX;  // never sample
+  double u = ((double)(uint32_t)_mi_heap_random_next(heap) + 1.0) / 4294967296.0;  // in (0,1]
+  size_t e = 0;
+  while (u < 0.5) { u *= 2.0; e++; }
+  const double f = 2.0*u - 1.0;                               // log2(u) = log2(1+f) - 1
+  const double log2u = f*(1.3466 - 0.3466*f) - 1.0;
+  const double interval = ((double)e - log2u) * 0.6931471805599453 * (double)rate;
+  return (size_t)interval + 1;
+}
+
+void _mi_heap_profile_init(mi_heap_t* heap) {
+  heap->profile_sample_rate  = mi_option_get_size(mi_option_profile_sample_rate);
+  heap->profile_sample_count = mi_profile_next_interval(heap);
+}
+
+// Estimate the allocated bytes represented by a sample of `size` bytes as `size / (1 - exp(-size/rate))`
+// (the probability that an allocation of `size` bytes is sampled). We use `(1 - x/1024)^1024` for `exp(-x)`.
+static double mi_profile_unsample(size_t size, size_t rate) {
+  if (rate <= 1 || size == 0) return (double)size;
+  const double x = (double)size / (double)rate;
+  if (x > 32.0) return (double)size;
+  double e = 1.0 - x/1024.0;
+  for (int i = 0; i < 10; i++) { e = e*e; }
+  return (double)size / (1.0 - e);
+}
+
+static mi_profile_t* mi_profile_get(void) {
+  mi_profile_t* prof = mi_atomic_load_ptr_acquire(mi_profile_t, &mi_profile);
+  if mi_likely(prof != NULL) return prof;
+  mi_lock(&mi_profile_lock) {
+    prof = mi_atomic_load_ptr_relaxed(mi_profile_t, &mi_profile);
+    if (prof == NULL) {
+      mi_memid_t memid;
+      prof = (mi_profile_t*)_mi_os_alloc(sizeof(mi_profile_t), &memid);
+      if (prof != NULL) {
+        if (!memid.initially_zero) { _mi_memzero(prof, sizeof(mi_profile_t)); }
+        prof->memid = memid;
+        mi_atomic_store_ptr_release(mi_profile_sample_t, &prof->samples, &prof->sample_tables[0][0]);
+        mi_atomic_store_ptr_release(mi_profile_t, &mi_profile, prof);
+      }
+    }
+  }
+  return prof;
+}
+
+
+/* -----------------------------------------------------------
+  Stack and sample tables (open addressing, modified under the lock)
+----------------------------------------------------------- */
+
+// find or add a stack trace; returns `SIZE_MAX` if the table is full
+static size_t mi_profile_stack_find(mi_profile_t* prof, void* const* frames, size_t depth) {
+  uintptr_t hash = depth;
+  for (size_t i = 0; i < depth; i++) { hash = _mi_random_shuffle(hash ^ (uintptr_t)frames[i]); }
+  if (hash == 0) { hash = 1; }
+  size_t i = hash & (MI_PROFILE_STACKS - 1);
+  for (size_t n = 0; n < MI_PROFILE_STACKS; n++) {
+    mi_profile_stack_t* const stack = &prof->stacks[i];
+    if (stack->hash == 0) {
+      if (prof->stack_count >= 3*(MI_PROFILE_STACKS/4)) return SIZE_MAX;
+      stack->hash = hash;
+      stack->depth = depth;
+      _mi_memcpy(stack->frames, frames, depth * sizeof(void*));
+      prof->stack_count++;
+      return i;
+    }
+    if (stack->hash == hash && stack->depth == depth && memcmp(stack->frames, frames, depth * sizeof(void*)) == 0) {
+      return i;
+    }
+    i = (i + 1) & (MI_PROFILE_STACKS - 1);
+  }
+  return SIZE_MAX;
+}
+
+static size_t mi_profile_sample_slot(uintptr_t block) {
+  return (size_t)(_mi_random_shuffle(block) & (MI_PROFILE_SAMPLES - 1));
+}
+
+// find a sample; this can be called without holding the lock (see `_mi_profile_free`)
+static mi_profile_sample_t* mi_profile_sample_find(mi_profile_sample_t* table, uintptr_t block) {
+  size_t i = mi_profile_sample_slot(block);
+  for (size_t n = 0; n < MI_PROFILE_SAMPLES; n++) {
+    const uintptr_t b = mi_atomic_load_acquire(&table[i].block);
+    if (b == block) return &table[i];
+    if (b == MI_PROFILE_SLOT_FREE) return NULL;
+    i = (i + 1) & (MI_PROFILE_SAMPLES - 1);
+  }
+  return NULL;
+}
+
+// rebuild the sample table without deleted slots into the other table. Lock-free lookups
+// (in `_mi_profile_free`) see the generation change and retry under the lock.
+static bool mi_profile_samples_rebuild(mi_profile_t* prof) {
+  if (prof->sample_count >= MI_PROFILE_SAMPLES/2) return false;  // too many live samples
+  mi_profile_sample_t* const from = mi_atomic_load_ptr_relaxed(mi_profile_sample_t, &prof->samples);
+  mi_profile_sample_t* const to = (from == &prof->sample_tables[0][0] ? &prof->sample_tables[1][0] : &prof->sample_tables[0][0]);
+  mi_atomic_increment_acq_rel(&prof->generation);
+  _mi_memzero(to, MI_PROFILE_SAMPLES * sizeof(mi_profile_sample_t));
+  for (size_t j = 0; j < MI_PROFILE_SAMPLES; j++) {
+    const uintptr_t b = mi_atomic_load_relaxed(&from[j].block);
+    if (b <= MI_PROFILE_SLOT_DELETED) continue;
+    size_t i = mi_profile_sample_slot(b);
+    while (mi_atomic_load_relaxed(&to[i].block) != MI_PROFILE_SLOT_FREE) { i = (i + 1) & (MI_PROFILE_SAMPLES - 1); }
+    to[i].size  = from[j].size;
+    to[i].rate  = from[j].rate;
+    to[i].stack = from[j].stack;
+    to[i].time  = from[j].time;
+    mi_atomic_store_relaxed(&to[i].block, b);
+  }
+  prof->sample_used = prof->sample_count;
+  mi_atomic_store_ptr_release(mi_profile_sample_t, &prof->samples, to);
+  mi_atomic_increment_acq_rel(&prof->generation);
+  return true;
+}
+
+static bool mi_profile_sample_add(mi_profile_t* prof, uintptr_t block, size_t size, size_t rate, size_t stack, mi_msecs_t time) {
+  if (prof->sample_used >= 3*(MI_PROFILE_SAMPLES/4)) {
+    if (!mi_profile_samples_rebuild(prof)) return false;
+  }
+  mi_profile_sample_t* const table = mi_atomic_load_ptr_relaxed(mi_profile_sample_t, &prof->samples);
+  size_t i = mi_profile_sample_slot(block);
+  while (true) {
+    const uintptr_t b = mi_atomic_load_relaxed(&table[i].block);
+    if (b == MI_PROFILE_SLOT_FREE || b == MI_PROFILE_SLOT_DELETED) {
+      table[i].size  = size;
+      table[i].rate  = rate;
+      table[i].stack = stack;
+      table[i].time  = time;
+      mi_atomic_store_release(&table[i].block, block);  // publish for lock-free lookups
+      if (b == MI_PROFILE_SLOT_FREE) { prof->sample_used++; }
+      prof->sample_count++;
+      return true;
+    }
+    i = (i + 1) & (MI_PROFILE_SAMPLES - 1);
+  }
+}
+
+static void mi_profile_sample_remove(mi_profile_t* prof, mi_profile_sample_t* sample) {
+  mi_atomic_store_release(&sample->block, MI_PROFILE_SLOT_DELETED);
+  prof->sample_count--;
+}
+
+
+/* -----------------------------------------------------------
+  Sampling and freeing
+----------------------------------------------------------- */
+
+// Called when the sample count of the heap reached 0 (see `alloc.c`)
+void _mi_heap_profile_sample(mi_heap_t* heap, void* p, size_t size) {
+  const size_t rate = heap->profile_sample_rate;
+  heap->profile_sample_count = mi_profile_next_interval(heap);
+  if (p == NULL || mi_profile_recurse) return;
+  mi_profile_recurse = true;  // capturing the stack trace may allocate
+  void* frames[MI_PROFILE_MAX_FRAMES];
+  const size_t depth = _mi_prim_capture_stack(frames, MI_PROFILE_MAX_FRAMES, 1 /* skip this function */);
+  mi_profile_t* const prof = mi_profile_get();
+  if (prof != NULL) {
+    const mi_msecs_t now = _mi_clock_now();
+    bool added = false;
+    mi_lock(&mi_profile_lock) {
+      const size_t stack = mi_profile_stack_find(prof, frames, depth);
+      if (stack != SIZE_MAX && mi_profile_sample_add(prof, (uintptr_t)p, size, rate, stack, now)) {
+        prof->stacks[stack].alloc_count++;
+        prof->stacks[stack].alloc_bytes += size;
+        prof->stacks[stack].alloc_estimate += mi_profile_unsample(size, rate);
+        added = true;
+      }
+      else {
+        prof->dropped++;
+      }
+    }
+    if (added) {
+      // ensure a free of this block takes the generic path
+      mi_page_set_has_sampled(_mi_ptr_page(p), true);
+    }
+  }
+  mi_profile_recurse = false;
+}
+
+// Called on free of a block in a page with sampled blocks (see `free.c`)
+void _mi_profile_free(const mi_block_t* block) {
+  mi_profile_t* const prof = mi_atomic_load_ptr_acquire(mi_profile_t, &mi_profile);
+  if (prof == NULL) return;
+  // check first without the lock if the block was sampled at all
+  const size_t gen = mi_atomic_load_acquire(&prof->generation);
+  if ((gen & 1) == 0) {
+    mi_profile_sample_t* const table = mi_atomic_load_ptr_acquire(mi_profile_sample_t, &prof->samples);
+    if (mi_profile_sample_find(table, (uintptr_t)block) == NULL && mi_atomic_load_acquire(&prof->generation) == gen) return;
+  }
+  mi_lock(&mi_profile_lock) {
+    mi_profile_sample_t* const table = mi_atomic_load_ptr_relaxed(mi_profile_sample_t, &prof->samples);
+    mi_profile_sample_t* const sample = mi_profile_sample_find(table, (uintptr_t)block);
+    if (sample != NULL) { mi_profile_sample_remove(prof, sample); }
+  }
+}
+
+// Called when the pages of a heap are destroyed (see `heap.c:mi_heap_destroy`)
+void _mi_profile_free_range(const void* start, size_t size) {
+  mi_profile_t* const prof = mi_atomic_load_ptr_acquire(mi_profile_t, &mi_profile);
+  if (prof == NULL) return;
+  mi_lock(&mi_profile_lock) {
+    mi_profile_sample_t* const table = mi_atomic_load_ptr_relaxed(mi_profile_sample_t, &prof->samples);
+    for (size_t i = 0; i < MI_PROFILE_SAMPLES; i++) {
+      const uintptr_t b = mi_atomic_load_relaxed(&table[i].block);
+      if (b >= (uintptr_t)start && b < (uintptr_t)start + size) { mi_profile_sample_remove(prof, &table[i]); }
+    }
+  }
+}
+
+
+// Called when a sampled block is resized without copying and possibly moved (see `alloc.c:_mi_heap_realloc_zero`)
+void _mi_profile_resize(const void* p, const void* newp, size_t newsize) {
+  mi_profile_t* const prof = mi_atomic_load_ptr_acquire(mi_profile_t, &mi_profile);
+  if (prof == NULL) return;
+  mi_lock(&mi_profile_lock) {
+    mi_profile_sample_t* const table = mi_atomic_load_ptr_relaxed(mi_profile_sample_t, &prof->samples);
+    mi_profile_sample_t* const sample = mi_profile_sample_find(table, (uintptr_t)p);
+    if (sample != NULL) {
+      if (p == newp) {
+        sample->size = newsize;
+      }
+      else {
+        // re-key the sample at its new address (keeping its stack and time)
+        const size_t rate = sample->rate;
+        const size_t stack = sample->stack;
+        const mi_msecs_t time = sample->time;
+        mi_profile_sample_remove(prof, sample);
+        if (!mi_profile_sample_add(prof, (uintptr_t)newp, newsize, rate, stack, time)) { prof->dropped++; }
+      }
+    }
+  }
+}
+
+
+/* -----------------------------------------------------------
+  Writing profiles
+----------------------------------------------------------- */
+
+typedef struct mi_profile_entry_s {
+  size_t      depth;
+  size_t      live_count;
+  size_t      live_bytes;
+  double      live_estimate;
+  size_t      alloc_count;
+  size_t      alloc_bytes;
+  double      alloc_estimate;
+  void*       frames[MI_PROFILE_MAX_FRAMES];
+} mi_profile_entry_t;
+
+// Legacy `pprof` heap profile format (as written by gperftools). The counts and bytes are the sampled
+// values and `pprof` scales them using the sample rate in the header. The mapped libraries at
+// the end are needed for `pprof` to symbolize the addresses.
+static void mi_profile_write_pprof(FILE* f, const mi_profile_entry_t* entries, size_t rate) {
+  size_t live_count = 0, live_bytes = 0, alloc_count = 0, alloc_bytes = 0;
+  for (size_t i = 0; i < MI_PROFILE_STACKS; i++) {
+    live_count  += entries[i].live_count;   live_bytes  += entries[i].live_bytes;
+    alloc_count += entries[i].alloc_count;  alloc_bytes += entries[i].alloc_bytes;
+  }
+  fprintf(f, "heap profile: %6zu: %8zu [%6zu: %8zu] @ heap_v2/%zu\n", live_count, live_bytes, alloc_count, alloc_bytes, rate);
+  for (size_t i = 0; i < MI_PROFILE_STACKS; i++) {
+    const mi_profile_entry_t* const entry = &entries[i];
+    if (entry->alloc_count == 0) continue;
+    fprintf(f, "%6zu: %8zu [%6zu: %8zu] @", entry->live_count, entry->live_bytes, entry->alloc_count, entry->alloc_bytes);
+    for (size_t j = 0; j < entry->depth; j++) { fprintf(f, " 0x%zx", (size_t)entry->frames[j]); }
+    fputc('\n', f);
+  }
+  fputs("\nMAPPED_LIBRARIES:\n", f);
+  #if defined(__linux__)
+  FILE* maps = fopen("/proc/self/maps", "r");
+  if (maps != NULL) {
+    char buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), maps)) > 0) { fwrite(buf, 1, n, f); }
+    fclose(maps);
+  }
+  #endif
+}
+
+// Collapsed (or folded) stacks as used by `flamegraph.pl`: the frames from the outermost caller
+// to the allocation separated by `;`, followed by the estimated bytes.
+static void mi_profile_write_collapsed(FILE* f, const mi_profile_entry_t* entries, bool cumulative) {
+  for (size_t i = 0; i < MI_PROFILE_STACKS; i++) {
+    const mi_profile_entry_t* const entry = &entries[i];
+    const double bytes = (cumulative ? entry->alloc_estimate : entry->live_estimate);
+    if (bytes < 1.0) continue;
+    if (entry->depth == 0) { fputs("[unknown]", f); }
+    for (size_t j = entry->depth; j > 0; j--) {
+      fprintf(f, (j == entry->depth ? "0x%zx" : ";0x%zx"), (size_t)entry->frames[j-1]);
+    }
+    fprintf(f, " %zu\n", (size_t)bytes);
+  }
+}
+
+int mi_profile_dump(const char* fname, mi_profile_format_t format, bool cumulative, size_t min_age_msecs) mi_attr_noexcept {
+  if (fname == NULL) return EINVAL;
+  mi_memid_t memid;
+  const size_t entries_size = MI_PROFILE_STACKS * sizeof(mi_profile_entry_t);
+  mi_profile_entry_t* const entries = (mi_profile_entry_t*)_mi_os_alloc(entries_size, &memid);
+  if (entries == NULL) return ENOMEM;
+  if (!memid.initially_zero) { _mi_memzero(entries, entries_size); }
+
+  // take a snapshot under the lock (so we do not hold the lock while writing the file)
+  size_t dropped = 0;
+  mi_profile_t* const prof = mi_atomic_load_ptr_acquire(mi_profile_t, &mi_profile);
+  if (prof != NULL) {
+    const mi_msecs_t now = _mi_clock_now();
+    mi_lock(&mi_profile_lock) {
+      for (size_t i = 0; i < MI_PROFILE_STACKS; i++) {
+        const mi_profile_stack_t* const stack = &prof->stacks[i];
+        if (stack->hash == 0) continue;
+        entries[i].depth = stack->depth;
+        entries[i].alloc_count = stack->alloc_count;
+        entries[i].alloc_bytes = stack->alloc_bytes;
+        entries[i].alloc_estimate = stack->alloc_estimate;
+        _mi_memcpy(entries[i].frames, stack->frames, stack->depth * sizeof(void*));
+      }
+      const mi_profile_sample_t* const table = mi_atomic_load_ptr_relaxed(mi_profile_sample_t, &prof->samples);
+      for (size_t i = 0; i < MI_PROFILE_SAMPLES; i++) {
+        const mi_profile_sample_t* const sample = &table[i];
+        if (mi_atomic_load_relaxed(&sample->block) <= MI_PROFILE_SLOT_DELETED) continue;
+        if (now - sample->time < (mi_msecs_t)min_age_msecs) continue;
+        mi_profile_entry_t* const entry = &entries[sample->stack];
+        entry->live_count++;
+        entry->live_bytes += sample->size;
+        entry->live_estimate += mi_profile_unsample(sample->size, sample->rate);
+      }
+      dropped = prof->dropped;
+    }
+  }
+  if (dropped > 0) {
+    _mi_warning_message("heap profile: %zu samples were dropped as the profile tables were full\n", dropped);
+  }
+
+  // and write it
+  int err = 0;
+  FILE* f = fopen(fname, "w");
+  if (f == NULL) {
+    err = (errno != 0 ? errno : EIO);
+  }
+  else {
+    if (format == mi_profile_format_collapsed) {
+      mi_profile_write_collapsed(f, entries, cumulative);
+    }
+    else {
+      mi_profile_write_pprof(f, entries, mi_option_get_size(mi_option_profile_sample_rate));
+    }
+    if (fclose(f) != 0) { err = (errno != 0 ? errno : EIO); }
+  }
+  _mi_os_free(entries, entries_size, memid);
+  return err;
+}
+
+#else
+
+void _mi_profile_init(void) {
+}
+
+void _mi_heap_profile_init(mi_heap_t* heap) {
+  MI_UNUSED(heap);
+}
+
+int mi_profile_dump(const char* fname, mi_profile_format_t format, bool cumulative, size_t min_age_msecs) mi_attr_noexcept {
+  MI_UNUSED(fname); MI_UNUSED(format); MI_UNUSED(cumulative); MI_UNUSED(min_age_msecs);
+  return ENOTSUP;
+}
+
+#endif
@@ -81,6 +81,7 @@ static mi_segmap_part_t* mi_segment_map_index_of(const mi_segment_t* segment, bo
 
 void _mi_segment_map_allocated_at(const mi_segment_t* segment) {
   if (segment->memid.memkind == MI_MEM_ARENA) return; // we lookup segments first in the arena's and don't need the segment map
+  if (segment->memid.memkind == MI_MEM_OS_REGION) return; // or in the reserved OS region
   size_t index;
   size_t bitidx;
   mi_segmap_part_t* part = mi_segment_map_index_of(segment, true /* alloc map if needed */, &index, &bitidx);
@@ -93,7 +94,7 @@ void _mi_segment_map_allocated_at(const mi_segment_t* segment) {
 }
 
 void _mi_segment_map_freed_at(const mi_segment_t* segment) {
-  if (segment->memid.memkind == MI_MEM_ARENA) return;
+  if (segment->memid.memkind == MI_MEM_ARENA || segment->memid.memkind == MI_MEM_OS_REGION) return;
   size_t index;
   size_t bitidx;
   mi_segmap_part_t* part = mi_segment_map_index_of(segment, false /* don't alloc if not present */, &index, &bitidx);
@@ -124,7 +125,9 @@ static mi_segment_t* _mi_segment_of(const void* p) {
 
 // Is this a valid pointer in our heap?
 static bool mi_is_valid_pointer(const void* p) {
-  // first check if it is in an arena, then check if it is OS allocated
+  // with a reserved OS region, memory inside the region is ours if that part of the region is in use
+  if (_mi_os_region_contains(p)) return _mi_os_region_is_inuse(p);
+  // otherwise, first check if it is in an arena, then check if it is OS allocated
   return (_mi_arena_contains(p) || _mi_segment_of(p) != NULL);
 }
 
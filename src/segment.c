@@ -404,10 +404,18 @@ static void mi_segments_track_size(long segment_size, mi_segments_tld_t* tld) {
   if (tld->current_size > tld->peak_size) tld->peak_size = tld->current_size;
 }
 
+static void mi_segments_track_numa(mi_segment_t* segment, bool alloc, mi_segments_tld_t* tld) {
+  if (segment->numa_node < 0) return;  // unknown node
+  mi_stat_count_t* stat = (segment->numa_remote ? &tld->stats->segments_numa_remote : &tld->stats->segments_numa_local);
+  if (alloc) { _mi_stat_increase(stat, mi_segment_size(segment)); }
+        else { _mi_stat_decrease(stat, mi_segment_size(segment)); }
+}
+
 static void mi_segment_os_free(mi_segment_t* segment, mi_segments_tld_t* tld) {
   segment->thread_id = 0;
   _mi_segment_map_freed_at(segment);
   mi_segments_track_size(-((long)mi_segment_size(segment)),tld);
+  mi_segments_track_numa(segment, false, tld);
   if (segment->was_reclaimed) {
     tld->reclaim_count--;
     segment->was_reclaimed = false;
@@ -434,6 +442,19 @@ static void mi_segment_os_free(mi_segment_t* segment, mi_segments_tld_t* tld) {
    Commit/Decommit ranges
 ----------------------------------------------------------- */
 
+// In THP mode we commit and purge at the huge OS page granularity (2MiB) so that transparent
+// huge pages are never split by purging just a part of them.
+#define MI_THP_COMMIT_SIZE     (2*MI_MiB)
+#define MI_THP_COLLAPSE_DELAY  (1000)   // milli-seconds a segment must be alive before we try to collapse it
+#if (MI_SEGMENT_SIZE % MI_THP_COMMIT_SIZE) != 0 || (MI_THP_COMMIT_SIZE % MI_COMMIT_SIZE) != 0
+#undef  MI_THP_COMMIT_SIZE
+#define MI_THP_COMMIT_SIZE     MI_COMMIT_SIZE
+#endif
+
+static bool mi_segment_thp_mode(void) {
+  return (MI_THP_COMMIT_SIZE > MI_COMMIT_SIZE && mi_option_is_enabled(mi_option_thp_mode));
+}
+
 static void mi_segment_commit_mask(mi_segment_t* segment, bool conservative, uint8_t* p, size_t size, uint8_t** start_p, size_t* full_size, mi_commit_mask_t* cm) {
   mi_assert_internal(_mi_ptr_segment(p + 1) == segment);
   mi_assert_internal(segment->kind != MI_SEGMENT_HUGE);
@@ -448,17 +469,19 @@ static void mi_segment_commit_mask(mi_segment_t* segment, bool conservative, uin
 
   size_t start;
   size_t end;
+  const bool thp = mi_segment_thp_mode();
   if (conservative) {
     // decommit conservative
-    start = _mi_align_up(pstart, MI_COMMIT_SIZE);
-    end   = _mi_align_down(pstart + size, MI_COMMIT_SIZE);
+    start = _mi_align_up(pstart, (thp ? MI_THP_COMMIT_SIZE : MI_COMMIT_SIZE));
+    end   = _mi_align_down(pstart + size, (thp ? MI_THP_COMMIT_SIZE : MI_COMMIT_SIZE));
     mi_assert_internal(start >= segstart);
     mi_assert_internal(end <= segsize);
+    if (end < start) { end = start; }
   }
   else {
     // commit liberal
-    start = _mi_align_down(pstart, MI_MINIMAL_COMMIT_SIZE);
-    end   = _mi_align_up(pstart + size, MI_MINIMAL_COMMIT_SIZE);
+    start = _mi_align_down(pstart, (thp ? MI_THP_COMMIT_SIZE : MI_MINIMAL_COMMIT_SIZE));
+    end   = _mi_align_up(pstart + size, (thp ? MI_THP_COMMIT_SIZE : MI_MINIMAL_COMMIT_SIZE));
   }
   if (pstart >= segstart && start < segstart) {  // note: the mask is also calculated for an initial commit of the info area
     start = segstart;
@@ -467,7 +490,7 @@ static void mi_segment_commit_mask(mi_segment_t* segment, bool conservative, uin
     end = segsize;
   }
 
-  mi_assert_internal(start <= pstart && (pstart + size) <= end);
+  mi_assert_internal(conservative || (start <= pstart && (pstart + size) <= end));
   mi_assert_internal(start % MI_COMMIT_SIZE==0 && end % MI_COMMIT_SIZE == 0);
   *start_p   = (uint8_t*)segment + start;
   *full_size = (end > start ? end - start : 0);
@@ -506,7 +529,7 @@ static bool mi_segment_commit(mi_segment_t* segment, uint8_t* p, size_t size) {
 
   // increase purge expiration when using part of delayed purges -- we assume more allocations are coming soon.
   if (mi_commit_mask_any_set(&segment->purge_mask, &mask)) {
-    segment->purge_expire = _mi_clock_now() + mi_option_get(mi_option_purge_delay);
+    segment->purge_expire = _mi_clock_now() + _mi_os_purge_delay();
   }
 
   // always clear any delayed purges in our range (as they are either committed now)
@@ -554,7 +577,7 @@ static bool mi_segment_purge(mi_segment_t* segment, uint8_t* p, size_t size) {
 static void mi_segment_schedule_purge(mi_segment_t* segment, uint8_t* p, size_t size) {
   if (!segment->allow_purge) return;
 
-  if (mi_option_get(mi_option_purge_delay) == 0) {
+  if (_mi_os_purge_delay() == 0) {
     mi_segment_purge(segment, p, size);
   }
   else {
@@ -573,7 +596,7 @@ static void mi_segment_schedule_purge(mi_segment_t* segment, uint8_t* p, size_t
     mi_msecs_t now = _mi_clock_now();
     if (segment->purge_expire == 0) {
       // no previous purgess, initialize now
-      segment->purge_expire = now + mi_option_get(mi_option_purge_delay);
+      segment->purge_expire = now + _mi_os_purge_delay();
     }
     else if (segment->purge_expire <= now) {
       // previous purge mask already expired
@@ -600,24 +623,51 @@ static void mi_segment_try_purge(mi_segment_t* segment, bool force) {
   segment->purge_expire = 0;
   mi_commit_mask_create_empty(&segment->purge_mask);
 
+  // collect the sequences and purge them together so the OS can be called just once
+  // (all ranges are fully committed as the purge mask is a subset of the commit mask)
+  mi_assert_internal(mi_commit_mask_all_set(&segment->commit_mask, &mask));
+  mi_assert_internal(segment->allow_decommit);
+  mi_os_range_t ranges[32];
+  size_t range_count = 0;
+  bool decommitted = false;
   size_t idx;
   size_t count;
   mi_commit_mask_foreach(&mask, idx, count) {
-    // if found, decommit that sequence
     if (count > 0) {
-      uint8_t* p = (uint8_t*)segment + (idx*MI_COMMIT_SIZE);
-      size_t size = count * MI_COMMIT_SIZE;
-      mi_segment_purge(segment, p, size);
+      if (range_count >= 32) {
+        decommitted = _mi_os_purge_ranges(ranges, range_count) || decommitted;
+        range_count = 0;
+      }
+      mi_assert_internal(idx > 0);  // never purge the segment info
+      ranges[range_count].start = (uint8_t*)segment + (idx*MI_COMMIT_SIZE);
+      ranges[range_count].size  = count * MI_COMMIT_SIZE;
+      range_count++;
     }
   }
   mi_commit_mask_foreach_end()
+  decommitted = _mi_os_purge_ranges(ranges, range_count) || decommitted;
+  if (decommitted) {
+    mi_commit_mask_clear(&segment->commit_mask, &mask);
+  }
   mi_assert_internal(mi_commit_mask_is_empty(&segment->purge_mask));
 }
 
+// In THP mode 2, collapse dense segments that have been alive for a while into transparent huge pages.
+// A segment is dense if it is fully committed and has no pending purges.
+static void mi_segment_try_collapse(mi_segment_t* segment) {
+  if mi_likely(segment->thp_collapse == 0) return;
+  if (!mi_commit_mask_is_full(&segment->commit_mask) || !mi_commit_mask_is_empty(&segment->purge_mask)) return;
+  const mi_msecs_t now = _mi_clock_now();
+  if (now < segment->thp_collapse) return;
+  segment->thp_collapse = 0;  // only try once
+  _mi_os_collapse(segment, mi_segment_size(segment));
+}
+
 // called from `mi_heap_collect_ex`
 // this can be called per-page so it is important that try_purge has fast exit path
 void _mi_segment_collect(mi_segment_t* segment, bool force) {
   mi_segment_try_purge(segment, force);
+  mi_segment_try_collapse(segment);
 }
 
 /* -----------------------------------------------------------
@@ -728,26 +778,8 @@ static mi_slice_t* mi_segment_span_free_coalesce(mi_slice_t* slice, mi_segments_
    Page allocation
 ----------------------------------------------------------- */
 
-// Note: may still return NULL if committing the memory failed
-static mi_page_t* mi_segment_span_allocate(mi_segment_t* segment, size_t slice_index, size_t slice_count) {
-  mi_assert_internal(slice_index < segment->slice_entries);
-  mi_slice_t* const slice = &segment->slices[slice_index];
-  mi_assert_internal(slice->block_size==0 || slice->block_size==1);
-
-  // commit before changing the slice data
-  if (!mi_segment_ensure_committed(segment, _mi_segment_page_start_from_slice(segment, slice, 0, NULL), slice_count * MI_SEGMENT_SLICE_SIZE)) {
-    return NULL;  // commit failed!
-  }
-
-  // convert the slices to a page
-  slice->slice_offset = 0;
-  slice->slice_count = (uint32_t)slice_count;
-  mi_assert_internal(slice->slice_count == slice_count);
-  const size_t bsize = slice_count * MI_SEGMENT_SLICE_SIZE;
-  slice->block_size = bsize;
-  mi_page_t*  page = mi_slice_to_page(slice);
-  mi_assert_internal(mi_page_block_size(page) == bsize);
-
+// Set the back pointers of the slices in a used span (of `slice_count` slices starting at `slice_index`)
+static void mi_segment_span_set_offsets(mi_segment_t* segment, mi_slice_t* slice, size_t slice_index, size_t slice_count) {
   // set slice back pointers for the first MI_MAX_SLICE_OFFSET_COUNT entries
   size_t extra = slice_count-1;
   if (extra > MI_MAX_SLICE_OFFSET_COUNT) extra = MI_MAX_SLICE_OFFSET_COUNT;
@@ -770,6 +802,29 @@ static mi_page_t* mi_segment_span_allocate(mi_segment_t* segment, size_t slice_i
     last->slice_count = 0;
     last->block_size = 1;
   }
+}
+
+// Note: may still return NULL if committing the memory failed
+static mi_page_t* mi_segment_span_allocate(mi_segment_t* segment, size_t slice_index, size_t slice_count) {
+  mi_assert_internal(slice_index < segment->slice_entries);
+  mi_slice_t* const slice = &segment->slices[slice_index];
+  mi_assert_internal(slice->block_size==0 || slice->block_size==1);
+
+  // commit before changing the slice data
+  if (!mi_segment_ensure_committed(segment, _mi_segment_page_start_from_slice(segment, slice, 0, NULL), slice_count * MI_SEGMENT_SLICE_SIZE)) {
+    return NULL;  // commit failed!
+  }
+
+  // convert the slices to a page
+  slice->slice_offset = 0;
+  slice->slice_count = (uint32_t)slice_count;
+  mi_assert_internal(slice->slice_count == slice_count);
+  const size_t bsize = slice_count * MI_SEGMENT_SLICE_SIZE;
+  slice->block_size = bsize;
+  mi_page_t*  page = mi_slice_to_page(slice);
+  mi_assert_internal(mi_page_block_size(page) == bsize);
+
+  mi_segment_span_set_offsets(segment, slice, slice_index, slice_count);
 
   // and initialize the page
   page->is_committed = true;
@@ -790,7 +845,13 @@ static void mi_segment_slice_split(mi_segment_t* segment, mi_slice_t* slice, siz
   slice->slice_count = (uint32_t)slice_count;
 }
 
-static mi_page_t* mi_segments_page_find_and_allocate(size_t slice_count, mi_arena_id_t req_arena_id, mi_segments_tld_t* tld) {
+// Can a heap use a segment? (respecting exclusive arenas and the preferred numa node of the heap)
+static bool mi_segment_is_suitable(mi_segment_t* segment, mi_heap_t* heap) {
+  if (!_mi_heap_memid_is_suitable(heap, segment->memid)) return false;
+  return (heap->numa_node < 0 || segment->numa_node < 0 || segment->numa_node == heap->numa_node);
+}
+
+static mi_page_t* mi_segments_page_find_and_allocate(size_t slice_count, mi_heap_t* heap, mi_segments_tld_t* tld) {
   mi_assert_internal(slice_count*MI_SEGMENT_SLICE_SIZE <= MI_LARGE_OBJ_SIZE_MAX);
   // search from best fit up
   mi_span_queue_t* sq = mi_span_queue_for(slice_count, tld);
@@ -800,7 +861,7 @@ static mi_page_t* mi_segments_page_find_and_allocate(size_t slice_count, mi_aren
       if (slice->slice_count >= slice_count) {
         // found one
         mi_segment_t* segment = _mi_ptr_segment(slice);
-        if (_mi_arena_memid_is_suitable(segment->memid, req_arena_id)) {
+        if (mi_segment_is_suitable(segment, heap)) {
           // found a suitable page span
           mi_span_queue_delete(sq, slice);
 
@@ -825,11 +886,73 @@ static mi_page_t* mi_segments_page_find_and_allocate(size_t slice_count, mi_aren
 }
 
 
+// Try to grow a thread-local page that holds a single block in place such that its block
+// is at least `block_size` bytes. If the current span is too small, the free span that directly
+// follows the page is absorbed (and committed); any left over part is put back in the span queues.
+// Used for in-place reallocation of large blocks.
+bool _mi_segment_page_try_grow(mi_page_t* page, size_t block_size, mi_segments_tld_t* tld) {
+  mi_segment_t* const segment = _mi_page_segment(page);
+  mi_assert_internal(segment->thread_id == _mi_thread_id());
+  if (segment->kind == MI_SEGMENT_HUGE || page->reserved != 1 || block_size > MI_LARGE_OBJ_SIZE_MAX) return false;
+  mi_assert_internal(page->capacity == 1);
+
+  mi_slice_t* const slice = mi_page_to_slice(page);
+  uint8_t* const pstart = mi_slice_start(slice);
+  const size_t start_offset = (size_t)(page->page_start - pstart);
+  const size_t slices_needed = _mi_divide_up(start_offset + block_size, MI_SEGMENT_SLICE_SIZE);
+  size_t slice_count = slice->slice_count;
+  if (slices_needed > slice_count) {
+    // absorb the directly following free span
+    mi_slice_t* const next = slice + slice_count;
+    if (next >= mi_segment_slices_end(segment) || next->block_size != 0) return false;
+    mi_assert_internal(next->slice_count > 0 && next->slice_offset == 0);
+    const size_t total = slice_count + next->slice_count;
+    if (total < slices_needed) return false;
+    if (!mi_segment_ensure_committed(segment, mi_slice_start(next), (slices_needed - slice_count) * MI_SEGMENT_SLICE_SIZE)) {
+      return false;
+    }
+    mi_segment_span_remove_from_queue(next, tld);
+    if (total > slices_needed) {
+      mi_segment_span_free(segment, mi_slice_index(slice) + slices_needed, total - slices_needed, false /* don't purge */, tld);
+    }
+    // set the back pointers of all absorbed slices (which also clears the header and last slice of the free span)
+    for (size_t i = slice_count; i < slices_needed; i++) {
+      slice[i].slice_offset = (uint32_t)(sizeof(mi_slice_t) * i);
+      slice[i].slice_count  = 0;
+      slice[i].block_size   = 1;
+    }
+    slice->slice_count = (uint32_t)slices_needed;
+    slice_count = slices_needed;
+  }
+
+  // the single block now spans the entire page
+  const size_t bsize = (slice_count * MI_SEGMENT_SLICE_SIZE) - start_offset;
+  mi_assert_internal(bsize >= block_size && bsize >= mi_page_block_size(page));
+  _mi_stat_increase(&tld->stats->page_committed, bsize - mi_page_block_size(page));
+  page->block_size = bsize;
+  page->block_size_shift = (_mi_is_power_of_two(bsize) ? (uint8_t)mi_ctz((uintptr_t)bsize) : 0);
+  mi_assert_expensive(mi_segment_is_valid(segment, tld));
+  return true;
+}
+
+
 /* -----------------------------------------------------------
    Segment allocation
 ----------------------------------------------------------- */
 
-static mi_segment_t* mi_segment_os_alloc( size_t required, size_t page_alignment, bool eager_delayed, mi_arena_id_t req_arena_id,
+// Allocate huge segments in remappable OS memory?
+static bool mi_segment_huge_use_remap(mi_arena_id_t req_arena_id) {
+  #if (MI_SECURE>0) || MI_HUGE_PAGE_ABANDON
+  MI_UNUSED(req_arena_id);
+  return false;  // guard pages cannot be remapped, and abandoned huge pages are not owned by a thread
+  #else
+  return (req_arena_id == _mi_arena_id_none() &&
+          mi_option_is_enabled(mi_option_huge_remap) &&
+          !mi_option_is_enabled(mi_option_disallow_os_alloc));
+  #endif
+}
+
+static mi_segment_t* mi_segment_os_alloc( size_t required, size_t page_alignment, bool eager_delayed, mi_arena_id_t req_arena_id, int numa_node,
                                           size_t* psegment_slices, size_t* pinfo_slices,
                                           bool commit, mi_segments_tld_t* tld)
 
@@ -852,7 +975,14 @@ static mi_segment_t* mi_segment_os_alloc( size_t required, size_t page_alignment
   }
 
   const size_t segment_size = (*psegment_slices) * MI_SEGMENT_SLICE_SIZE;
-  mi_segment_t* segment = (mi_segment_t*)_mi_arena_alloc_aligned(segment_size, alignment, align_offset, commit, allow_large, req_arena_id, &memid);
+  mi_segment_t* segment = NULL;
+  if (required > 0 && page_alignment == 0 && mi_segment_huge_use_remap(req_arena_id)) {
+    // allocate huge segments in remappable memory so they can be reallocated without copying
+    segment = (mi_segment_t*)_mi_os_alloc_remappable(segment_size, alignment, &memid);
+  }
+  if (segment == NULL) {
+    segment = (mi_segment_t*)_mi_arena_alloc_aligned(segment_size, alignment, align_offset, commit, allow_large, req_arena_id, numa_node, &memid);
+  }
   if (segment == NULL) {
     return NULL;  // failed to allocate
   }
@@ -880,18 +1010,23 @@ static mi_segment_t* mi_segment_os_alloc( size_t required, size_t page_alignment
   segment->allow_purge = segment->allow_decommit && (mi_option_get(mi_option_purge_delay) >= 0);
   segment->segment_size = segment_size;
   segment->subproc = tld->subproc;
+  segment->numa_node = _mi_arena_memid_numa_node(memid);
+  segment->numa_remote = (segment->numa_node >= 0 && segment->numa_node != (numa_node >= 0 ? numa_node : _mi_os_numa_node()));
   segment->commit_mask = commit_mask;
   segment->purge_expire = 0;
   mi_commit_mask_create_empty(&segment->purge_mask);
+  segment->thp_collapse = (mi_segment_thp_mode() && mi_option_get(mi_option_thp_mode) >= 2 && segment->allow_decommit
+                            ? _mi_clock_now() + MI_THP_COLLAPSE_DELAY : 0);
 
   mi_segments_track_size((long)(segment_size), tld);
+  mi_segments_track_numa(segment, true, tld);
   _mi_segment_map_allocated_at(segment);
   return segment;
 }
 
 
 // Allocate a segment from the OS aligned to `MI_SEGMENT_SIZE` .
-static mi_segment_t* mi_segment_alloc(size_t required, size_t page_alignment, mi_arena_id_t req_arena_id, mi_segments_tld_t* tld, mi_page_t** huge_page)
+static mi_segment_t* mi_segment_alloc(size_t required, size_t page_alignment, mi_arena_id_t req_arena_id, int numa_node, mi_segments_tld_t* tld, mi_page_t** huge_page)
 {
   mi_assert_internal((required==0 && huge_page==NULL) || (required>0 && huge_page != NULL));
 
@@ -908,7 +1043,7 @@ static mi_segment_t* mi_segment_alloc(size_t required, size_t page_alignment, mi
   bool commit = eager || (required > 0);
 
   // Allocate the segment from the OS
-  mi_segment_t* segment = mi_segment_os_alloc(required, page_alignment, eager_delay, req_arena_id,
+  mi_segment_t* segment = mi_segment_os_alloc(required, page_alignment, eager_delay, req_arena_id, numa_node,
                                               &segment_slices, &info_slices, commit, tld);
   if (segment == NULL) return NULL;
 
@@ -1094,6 +1229,33 @@ by scanning the arena memory
    Abandon segment/page
 ----------------------------------------------------------- */
 
+// Mark a segment as abandoned and add it to the abandoned index: under the bins of the pages
+// that have free blocks, and as mostly free if at least half of its slices are free.
+static void mi_segment_mark_abandoned(mi_segment_t* segment) {
+  uint8_t buckets[MI_ABANDONED_HINT_MAX];
+  size_t count = 0;
+  if (segment->kind != MI_SEGMENT_HUGE && segment->memid.memkind == MI_MEM_ARENA) {
+    size_t free_slices = 0;
+    mi_slice_t* slice = &segment->slices[0];
+    const mi_slice_t* end = mi_segment_slices_end(segment);
+    while (slice < end) {
+      mi_page_t* const page = mi_slice_to_page(slice);
+      if (!mi_slice_is_used(slice)) {
+        free_slices += slice->slice_count;
+      }
+      else if (count < MI_ABANDONED_HINT_MAX - 1 && page->reserved > 0 && mi_page_has_any_available(page)) {
+        const uint8_t bin = (uint8_t)_mi_bin(mi_page_block_size(page));
+        bool found = false;
+        for (size_t i = 0; i < count && !found; i++) { found = (buckets[i] == bin); }
+        if (!found) { buckets[count++] = bin; }
+      }
+      slice = slice + slice->slice_count;
+    }
+    if (2*free_slices >= segment->slice_entries) { buckets[count++] = MI_ABANDONED_HINT_FREE; }
+  }
+  _mi_arena_segment_mark_abandoned_indexed(segment, buckets, count);
+}
+
 static void mi_segment_abandon(mi_segment_t* segment, mi_segments_tld_t* tld) {
   mi_assert_internal(segment->used == segment->abandoned);
   mi_assert_internal(segment->used > 0);
@@ -1128,7 +1290,7 @@ static void mi_segment_abandon(mi_segment_t* segment, mi_segments_tld_t* tld) {
     tld->reclaim_count--;
     segment->was_reclaimed = false;
   }
-  _mi_arena_segment_mark_abandoned(segment);
+  mi_segment_mark_abandoned(segment);
 }
 
 void _mi_segment_page_abandon(mi_page_t* page, mi_segments_tld_t* tld) {
@@ -1280,7 +1442,7 @@ static mi_segment_t* mi_segment_reclaim(mi_segment_t* segment, mi_heap_t* heap,
 bool _mi_segment_attempt_reclaim(mi_heap_t* heap, mi_segment_t* segment) {
   if (mi_atomic_load_relaxed(&segment->thread_id) != 0) return false;  // it is not abandoned
   if (segment->subproc != heap->tld->segments.subproc)  return false;  // only reclaim within the same subprocess
-  if (!_mi_heap_memid_is_suitable(heap,segment->memid)) return false;  // don't reclaim between exclusive and non-exclusive arena's
+  if (!mi_segment_is_suitable(segment,heap)) return false;  // don't reclaim between exclusive and non-exclusive arena's (or numa nodes)
   const long target = _mi_option_get_fast(mi_option_target_segments_per_thread);
   if (target > 0 && (size_t)target <= heap->tld->segments.count) return false; // don't reclaim if going above the target count
 
@@ -1317,7 +1479,8 @@ static bool segment_count_is_within_target(mi_segments_tld_t* tld, size_t* ptarg
 
 static long mi_segment_get_reclaim_tries(mi_segments_tld_t* tld) {
   // limit the tries to 10% (default) of the abandoned segments with at least 8 and at most 1024 tries.
-  const size_t perc = (size_t)mi_option_get_clamp(mi_option_max_segment_reclaim, 0, 100);
+  // under memory pressure we try to reclaim all abandoned segments to avoid allocating fresh ones
+  const size_t perc = (_mi_os_memory_pressure() > 0 ? 100 : (size_t)mi_option_get_clamp(mi_option_max_segment_reclaim, 0, 100));
   if (perc <= 0) return 0;
   const size_t total_count = mi_atomic_load_relaxed(&tld->subproc->abandoned_count);
   if (total_count == 0) return 0;
@@ -1327,6 +1490,51 @@ static long mi_segment_get_reclaim_tries(mi_segments_tld_t* tld) {
   return max_tries;
 }
 
+// Visit an abandoned segment that we cleared (from the abandoned index or a cursor) while trying to reclaim.
+// Returns `true` if we are done (with the result in `*result`). Sets `*counts` to `false` if the segment
+// was not suitable and the visit should not count as a try. If `local_node >= 0` only segments on that
+// numa node (or without a known node) are suitable. A segment that is not reclaimed is abandoned again,
+// unless `deferred` is not NULL in which case it is added to `deferred` to be abandoned later by the caller.
+static bool mi_segment_try_reclaim_visit(mi_segment_t* segment, mi_heap_t* heap, int local_node, size_t needed_slices, size_t block_size,
+                                         bool* reclaimed, mi_segment_t** result, bool* counts, mi_segment_t** deferred, mi_segments_tld_t* tld)
+{
+  mi_assert(segment->subproc == heap->tld->segments.subproc); // only segments in our sub-process are visited
+  *counts = true;
+  segment->abandoned_visits++;
+  // todo: an arena exclusive heap will potentially visit many abandoned unsuitable segments and use many tries
+  // Perhaps we can skip non-suitable ones in a better way?
+  const bool is_suitable = mi_segment_is_suitable(segment, heap) &&
+                           (local_node < 0 || segment->numa_node < 0 || segment->numa_node == local_node);
+  bool has_page = mi_segment_check_free(segment,needed_slices,block_size,tld); // try to free up pages (due to concurrent frees)
+  if (segment->used == 0) {
+    // free the segment (by forced reclaim) to make it available to other threads.
+    // note1: we prefer to free a segment as that might lead to reclaiming another
+    // segment that is still partially used.
+    // note2: we could in principle optimize this by skipping reclaim and directly
+    // freeing but that would violate some invariants temporarily)
+    mi_segment_reclaim(segment, heap, 0, NULL, tld);
+  }
+  else if (has_page && is_suitable) {
+    // found a large enough free span, or a page of the right block_size with free space
+    // we return the result of reclaim (which is usually `segment`) as it might free
+    // the segment due to concurrent frees (in which case `NULL` is returned).
+    *result = mi_segment_reclaim(segment, heap, block_size, reclaimed, tld);
+    return true;
+  }
+  else if (segment->abandoned_visits > 3 && is_suitable) {
+    // always reclaim on 3rd visit to limit the abandoned segment count.
+    mi_segment_reclaim(segment, heap, 0, NULL, tld);
+  }
+  else {
+    // otherwise, push on the visited list so it gets not looked at too quickly again
+    *counts = false; // don't count this as a try since it was not suitable
+    mi_segment_try_purge(segment, false /* true force? */); // force purge if needed as we may not visit soon again
+    if (deferred != NULL) { *deferred = segment; }
+                     else { mi_segment_mark_abandoned(segment); }
+  }
+  return false;
+}
+
 static mi_segment_t* mi_segment_try_reclaim(mi_heap_t* heap, size_t needed_slices, size_t block_size, bool* reclaimed, mi_segments_tld_t* tld)
 {
   *reclaimed = false;
@@ -1335,43 +1543,48 @@ static mi_segment_t* mi_segment_try_reclaim(mi_heap_t* heap, size_t needed_slice
 
   mi_segment_t* result = NULL;
   mi_segment_t* segment = NULL;
+  bool counts;
+  bool done = false;
   mi_arena_field_cursor_t current;
   _mi_arena_field_cursor_init(heap, tld->subproc, false /* non-blocking */, &current);
-  while (segment_count_is_within_target(tld,NULL) && (max_tries-- > 0) && ((segment = _mi_arena_segment_clear_abandoned_next(&current)) != NULL))
-  {
-    mi_assert(segment->subproc == heap->tld->segments.subproc); // cursor only visits segments in our sub-process
-    segment->abandoned_visits++;
-    // todo: should we respect numa affinity for abandoned reclaim? perhaps only for the first visit?
-    // todo: an arena exclusive heap will potentially visit many abandoned unsuitable segments and use many tries
-    // Perhaps we can skip non-suitable ones in a better way?
-    bool is_suitable = _mi_heap_memid_is_suitable(heap, segment->memid);
-    bool has_page = mi_segment_check_free(segment,needed_slices,block_size,tld); // try to free up pages (due to concurrent frees)
-    if (segment->used == 0) {
-      // free the segment (by forced reclaim) to make it available to other threads.
-      // note1: we prefer to free a segment as that might lead to reclaiming another
-      // segment that is still partially used.
-      // note2: we could in principle optimize this by skipping reclaim and directly
-      // freeing but that would violate some invariants temporarily)
-      mi_segment_reclaim(segment, heap, 0, NULL, tld);
-    }
-    else if (has_page && is_suitable) {
-      // found a large enough free span, or a page of the right block_size with free space
-      // we return the result of reclaim (which is usually `segment`) as it might free
-      // the segment due to concurrent frees (in which case `NULL` is returned).
-      result = mi_segment_reclaim(segment, heap, block_size, reclaimed, tld);
-      break;
-    }
-    else if (segment->abandoned_visits > 3 && is_suitable) {
-      // always reclaim on 3rd visit to limit the abandoned segment count.
-      mi_segment_reclaim(segment, heap, 0, NULL, tld);
-    }
-    else {
-      // otherwise, push on the visited list so it gets not looked at too quickly again
-      max_tries++; // don't count this as a try since it was not suitable
-      mi_segment_try_purge(segment, false /* true force? */); // force purge if needed as we may not visit soon again
-      _mi_arena_segment_mark_abandoned(segment);
+  // prefer segments on our own numa node; only reclaim remote ones after a number of failed attempts
+  // (or under memory pressure) to avoid silently migrating memory across nodes as threads come and go.
+  const long numa_tries = mi_option_get(mi_option_abandoned_reclaim_numa_tries);
+  const bool numa_remote = (numa_tries >= 0 && (tld->reclaim_numa_misses >= (size_t)numa_tries || _mi_os_memory_pressure() > 0));
+  _mi_arena_field_cursor_prefer_numa(&current, (heap->numa_node >= 0 ? heap->numa_node : _mi_os_numa_node()), numa_remote);
+  const int local_node = (current.numa_pass > 0 && !numa_remote ? current.numa_node : -1);
+
+  // first try the abandoned index: segments with free blocks in our bin, and then mostly free segments
+  // (as the index is keyed on arena positions it is not used for heaps in an exclusive arena).
+  // Segments that are not reclaimed are only abandoned (and indexed) again at the end, as re-indexing
+  // them right away would make them the newest hints and we would visit them again in this call.
+  mi_segment_t* deferred[2*MI_ABANDONED_HINTS];
+  size_t deferred_count = 0;
+  if (heap->arena_id == _mi_arena_id_none()) {
+    const size_t buckets[2] = { _mi_bin(block_size), MI_ABANDONED_HINT_FREE };
+    for (size_t i = 0; i < 2 && !done; i++) {
+      for (size_t n = 0; n < MI_ABANDONED_HINTS && !done && max_tries > 0 && segment_count_is_within_target(tld,NULL); n++) {
+        segment = _mi_arena_segment_clear_abandoned_indexed(tld->subproc, buckets[i]);
+        if (segment == NULL) break;
+        mi_segment_t* unreclaimed = NULL;
+        done = mi_segment_try_reclaim_visit(segment, heap, local_node, needed_slices, block_size, reclaimed, &result, &counts, &unreclaimed, tld);
+        if (unreclaimed != NULL) { deferred[deferred_count++] = unreclaimed; }
+        if (counts) { max_tries--; }
+      }
     }
   }
+
+  // otherwise walk the abandoned segments in the arenas
+  while (!done && segment_count_is_within_target(tld,NULL) && (max_tries > 0) && ((segment = _mi_arena_segment_clear_abandoned_next(&current)) != NULL)) {
+    done = mi_segment_try_reclaim_visit(segment, heap, -1, needed_slices, block_size, reclaimed, &result, &counts, NULL, tld);
+    if (counts) { max_tries--; }
+  }
+  for (size_t i = 0; i < deferred_count; i++) {
+    mi_segment_mark_abandoned(deferred[i]);
+  }
+  if (current.numa_pass > 0) {
+    tld->reclaim_numa_misses = (result != NULL ? 0 : tld->reclaim_numa_misses + 1);
+  }
   _mi_arena_field_cursor_done(&current);
   return result;
 }
@@ -1521,7 +1734,7 @@ static mi_segment_t* mi_segment_reclaim_or_alloc(mi_heap_t* heap, size_t needed_
     return segment;
   }
   // 2. otherwise allocate a fresh segment
-  return mi_segment_alloc(0, 0, heap->arena_id, tld, NULL);
+  return mi_segment_alloc(0, 0, heap->arena_id, heap->numa_node, tld, NULL);
 }
 
 
@@ -1537,7 +1750,7 @@ static mi_page_t* mi_segments_page_alloc(mi_heap_t* heap, mi_page_kind_t page_ki
   size_t page_size = _mi_align_up(required, (required > MI_MEDIUM_PAGE_SIZE ? MI_MEDIUM_PAGE_SIZE : MI_SEGMENT_SLICE_SIZE));
   size_t slices_needed = page_size / MI_SEGMENT_SLICE_SIZE;
   mi_assert_internal(slices_needed * MI_SEGMENT_SLICE_SIZE == page_size);
-  mi_page_t* page = mi_segments_page_find_and_allocate(slices_needed, heap->arena_id, tld); //(required <= MI_SMALL_SIZE_MAX ? 0 : slices_needed), tld);
+  mi_page_t* page = mi_segments_page_find_and_allocate(slices_needed, heap, tld); //(required <= MI_SMALL_SIZE_MAX ? 0 : slices_needed), tld);
   if (page==NULL) {
     // no free page, allocate a new segment and try again
     if (mi_segment_reclaim_or_alloc(heap, slices_needed, block_size, tld) == NULL) {
@@ -1561,10 +1774,10 @@ static mi_page_t* mi_segments_page_alloc(mi_heap_t* heap, mi_page_kind_t page_ki
    Huge page allocation
 ----------------------------------------------------------- */
 
-static mi_page_t* mi_segment_huge_page_alloc(size_t size, size_t page_alignment, mi_arena_id_t req_arena_id, mi_segments_tld_t* tld)
+static mi_page_t* mi_segment_huge_page_alloc(size_t size, size_t page_alignment, mi_arena_id_t req_arena_id, int numa_node, mi_segments_tld_t* tld)
 {
   mi_page_t* page = NULL;
-  mi_segment_t* segment = mi_segment_alloc(size,page_alignment,req_arena_id,tld,&page);
+  mi_segment_t* segment = mi_segment_alloc(size,page_alignment,req_arena_id,numa_node,tld,&page);
   if (segment == NULL || page==NULL) return NULL;
   mi_assert_internal(segment->used==1);
   mi_assert_internal(mi_page_block_size(page) >= size);
@@ -1592,6 +1805,59 @@ static mi_page_t* mi_segment_huge_page_alloc(size_t size, size_t page_alignment,
   return page;
 }
 
+// Resize the huge page of a segment in remappable memory such that its block is at least `size` bytes,
+// by remapping the segment memory without copying. The segment (and page) may move in which case
+// the page must no longer be in a page queue. Returns the (new) page, or NULL on failure.
+mi_page_t* _mi_segment_huge_page_remap(mi_page_t* page, size_t size, mi_segments_tld_t* tld) {
+  mi_segment_t* segment = _mi_page_segment(page);
+  mi_assert_internal(segment->kind == MI_SEGMENT_HUGE && segment->used == 1);
+  mi_assert_internal(segment->thread_id == _mi_thread_id());
+  if (segment->memid.memkind != MI_MEM_OS_REMAP || size > MI_MAX_ALLOC_SIZE) return NULL;
+
+  size_t info_slices;
+  const size_t segment_slices = mi_segment_calculate_slices(size, &info_slices);
+  mi_assert_internal(info_slices == segment->segment_info_slices);
+  if (segment_slices == segment->segment_slices) return page;  // already the right size
+  const size_t slice_index = mi_slice_index(page);
+  const size_t old_size  = mi_segment_size(segment);
+  const size_t new_size  = segment_slices * MI_SEGMENT_SLICE_SIZE;
+  const size_t old_bsize = mi_page_block_size(page);
+
+  // remap (note: the segment info is no longer accessible at the old address if it moved)
+  mi_memid_t memid = segment->memid;
+  _mi_segment_map_freed_at(segment);
+  mi_segment_t* const newsegment = (mi_segment_t*)_mi_os_remap(segment, new_size, MI_SEGMENT_ALIGN, &memid);
+  if (newsegment == NULL) {
+    _mi_segment_map_allocated_at(segment);
+    return NULL;
+  }
+  segment = newsegment;
+  segment->memid = memid;
+  segment->segment_size = new_size;
+  segment->segment_slices = segment_slices;
+  segment->slice_entries = (segment_slices > MI_SLICES_PER_SEGMENT ? MI_SLICES_PER_SEGMENT : segment_slices);
+  segment->cookie = _mi_ptr_cookie(segment);
+  _mi_segment_map_allocated_at(segment);
+  tld->current_size += new_size;
+  tld->current_size -= old_size;
+  if (tld->current_size > tld->peak_size) tld->peak_size = tld->current_size;
+
+  // and extend (or shrink) the page to the full segment
+  mi_slice_t* const slice = &segment->slices[slice_index];
+  slice->slice_count = (uint32_t)(segment_slices - info_slices);
+  mi_segment_span_set_offsets(segment, slice, slice_index, slice->slice_count);
+  page = mi_slice_to_page(slice);
+  size_t psize;
+  page->page_start = _mi_segment_page_start(segment, page, &psize);
+  page->block_size = psize;
+  page->block_size_shift = (_mi_is_power_of_two(psize) ? (uint8_t)mi_ctz((uintptr_t)psize) : 0);
+  if (psize > old_bsize) { _mi_stat_increase(&tld->stats->page_committed, psize - old_bsize); }
+                    else { _mi_stat_decrease(&tld->stats->page_committed, old_bsize - psize); }
+  mi_assert_internal(psize >= size);
+  mi_assert_expensive(mi_segment_is_valid(segment, tld));
+  return page;
+}
+
 #if MI_HUGE_PAGE_ABANDON
 // free huge block from another thread
 void _mi_segment_huge_page_free(mi_segment_t* segment, mi_page_t* page, mi_block_t* block) {
@@ -1648,7 +1914,7 @@ mi_page_t* _mi_segment_page_alloc(mi_heap_t* heap, size_t block_size, size_t pag
     mi_assert_internal(_mi_is_power_of_two(page_alignment));
     mi_assert_internal(page_alignment >= MI_SEGMENT_SIZE);
     if (page_alignment < MI_SEGMENT_SIZE) { page_alignment = MI_SEGMENT_SIZE; }
-    page = mi_segment_huge_page_alloc(block_size,page_alignment,heap->arena_id,tld);
+    page = mi_segment_huge_page_alloc(block_size,page_alignment,heap->arena_id,heap->numa_node,tld);
   }
   else if (block_size <= MI_SMALL_OBJ_SIZE_MAX) {
     page = mi_segments_page_alloc(heap,MI_PAGE_SMALL,block_size,block_size,tld);
@@ -1660,7 +1926,7 @@ mi_page_t* _mi_segment_page_alloc(mi_heap_t* heap, size_t block_size, size_t pag
     page = mi_segments_page_alloc(heap,MI_PAGE_LARGE,block_size,block_size,tld);
   }
   else {
-    page = mi_segment_huge_page_alloc(block_size,page_alignment,heap->arena_id,tld);
+    page = mi_segment_huge_page_alloc(block_size,page_alignment,heap->arena_id,heap->numa_node,tld);
   }
   mi_assert_internal(page == NULL || _mi_heap_memid_is_suitable(heap, _mi_page_segment(page)->memid));
   mi_assert_expensive(page == NULL || mi_segment_is_valid(_mi_page_segment(page),tld));
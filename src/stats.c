@@ -334,6 +334,10 @@ static void _mi_stats_print(mi_stats_t* stats, mi_output_fun* out0, void* arg0)
   mi_stat_print(&stats->segments, "segments", -1, out, arg);
   mi_stat_print(&stats->segments_abandoned, "-abandoned", -1, out, arg);
   mi_stat_print(&stats->segments_cache, "-cached", -1, out, arg);
+  if (_mi_os_numa_node_count() > 1) {
+    mi_stat_print(&stats->segments_numa_local, "-numa local", 1, out, arg);
+    mi_stat_print(&stats->segments_numa_remote, "-numa remote", 1, out, arg);
+  }
   mi_stat_print(&stats->pages, "pages", -1, out, arg);
   mi_stat_print(&stats->pages_abandoned, "-abandoned", -1, out, arg);
   mi_stat_counter_print(&stats->pages_extended, "-extended", out, arg);
@@ -368,6 +372,11 @@ static void _mi_stats_print(mi_stats_t* stats, mi_output_fun* out0, void* arg0)
     mi_printf_amount((int64_t)peak_commit, 1, out, arg, "%s");
   }
   _mi_fprintf(out, arg, "\n");
+  if (mi_option_is_enabled(mi_option_thp_mode)) {
+    _mi_fprintf(out, arg, "%10s: ", "thp");
+    mi_printf_amount((int64_t)mi_process_thp_size(), 1, out, arg, "%s");
+    _mi_fprintf(out, arg, "\n");
+  }
 }
 
 static mi_msecs_t mi_process_start; // = 0
@@ -467,6 +476,10 @@ mi_decl_export void mi_process_info(size_t* elapsed_msecs, size_t* user_msecs, s
   if (page_faults!=NULL)    *page_faults    = pinfo.page_faults;
 }
 
+mi_decl_export size_t mi_process_thp_size(void) mi_attr_noexcept {
+  return _mi_prim_thp_size();
+}
+
 
 // --------------------------------------------------------
 // Return statistics
@@ -570,6 +583,14 @@ static void mi_heap_buf_print_counter_value(mi_heap_buf_t* hbuf, const char* nam
   mi_heap_buf_print_value(hbuf, name, stat->total);
 }
 
+static void mi_heap_buf_print_frag_bin(mi_heap_buf_t* hbuf, const char* prefix, mi_frag_bin_t* bin, bool add_comma) {
+  char buf[256];
+  _mi_snprintf(buf, 256, "%s{ \"block_size\": %zu, \"pages\": %zu, \"reserved\": %zu, \"capacity\": %zu, \"used\": %zu, \"committed\": %zu, \"wasted\": %zu }%s\n",
+               prefix, bin->block_size, bin->page_count, bin->reserved, bin->capacity, bin->used, bin->committed, bin->wasted, (add_comma ? "," : ""));
+  buf[255] = 0;
+  mi_heap_buf_print(hbuf, buf);
+}
+
 #define MI_STAT_COUNT(stat)    mi_heap_buf_print_count_value(&hbuf, #stat, &stats->stat);
 #define MI_STAT_COUNTER(stat)  mi_heap_buf_print_counter_value(&hbuf, #stat, &stats->stat);
 
@@ -623,6 +644,15 @@ char* mi_stats_get_json(size_t output_size, char* output_buf) mi_attr_noexcept {
   for (size_t i = 0; i <= MI_BIN_HUGE; i++) {
     mi_heap_buf_print_count_bin(&hbuf, "    ", &stats->page_bins[i], i, i!=MI_BIN_HUGE);
   }
+  mi_heap_buf_print(&hbuf, "  ],\n");
+
+  // fragmentation of the pages of the current thread
+  mi_frag_info_t frag;
+  mi_fragmentation_get(&frag);
+  mi_heap_buf_print(&hbuf, "  \"fragmentation\": [\n");
+  for (size_t i = 0; i <= MI_BIN_HUGE; i++) {
+    mi_heap_buf_print_frag_bin(&hbuf, "    ", &frag.bins[i], i!=MI_BIN_HUGE);
+  }
   mi_heap_buf_print(&hbuf, "  ]\n");
   mi_heap_buf_print(&hbuf, "}\n");
   return hbuf.buf;
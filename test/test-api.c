@@ -26,10 +26,24 @@ we therefore test the API over various inputs. Please add more tests :-)
 #include <assert.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <errno.h>
+#include <string.h>
+#include <time.h>
 
 #ifdef __cplusplus
 #include <vector>
+#include <thread>
+#include <chrono>
+#elif !defined(_WIN32)
+#include <pthread.h>
+#else
+#include <windows.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/mman.h>  // mincore
+#include <unistd.h>    // sysconf
 #endif
 
 #include "mimalloc.h"
@@ -43,6 +57,11 @@ we therefore test the API over various inputs. Please add more tests :-)
 // ---------------------------------------------------------------------------
 bool test_heap1(void);
 bool test_heap2(void);
+bool test_free_batch_mt(void);
+bool test_heap_recycle_mt(void);
+bool test_heap_defrag(void);
+bool test_heap_limit(void);
+bool test_profile_sampled(void);
 bool test_stl_allocator1(void);
 bool test_stl_allocator2(void);
 
@@ -59,6 +78,36 @@ bool mem_is_zero(uint8_t* p, size_t size) {
   return true;
 }
 
+static void test_sleep(unsigned long msecs) {
+#if defined(__cplusplus)
+  std::this_thread::sleep_for(std::chrono::milliseconds(msecs));
+#elif !defined(_WIN32)
+  struct timespec ts;
+  ts.tv_sec  = (time_t)(msecs / 1000);
+  ts.tv_nsec = (long)((msecs % 1000) * 1000000);
+  nanosleep(&ts, NULL);
+#else
+  Sleep((DWORD)msecs);
+#endif
+}
+
+// the percentage of the OS pages in `[p,p+size)` that are resident in physical memory (or -1 if unknown)
+static int test_resident_percentage(void* p, size_t size) {
+#if defined(__linux__)
+  const size_t psize = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t count = (size + psize - 1) / psize;
+  unsigned char* vec = (unsigned char*)mi_malloc(count);
+  if (vec == NULL || mincore(p, size, vec) != 0) { mi_free(vec); return -1; }
+  size_t resident = 0;
+  for (size_t i = 0; i < count; i++) { if ((vec[i] & 1) != 0) resident++; }
+  mi_free(vec);
+  return (int)((100 * resident) / count);
+#else
+  (void)(p); (void)(size);
+  return -1;
+#endif
+}
+
 // ---------------------------------------------------------------------------
 // Main testing
 // ---------------------------------------------------------------------------
@@ -102,6 +151,35 @@ int main(void) {
     void* p = mi_malloc(67108872);
     mi_free(p);
   };
+  CHECK_BODY("malloc-batch") {
+    void* ps[1000];
+    const size_t n = mi_malloc_batch(24, 1000, ps);
+    result = (n == 1000);
+    for (size_t i = 0; i < n; i++) {
+      result = result && (ps[i] != NULL && mi_usable_size(ps[i]) >= 24);
+      if (i > 0) { result = result && (ps[i] != ps[i-1]); }
+      memset(ps[i], 0xAB, 24);
+    }
+    for (size_t i = 0; i < n; i++) { mi_free(ps[i]); }
+  };
+  CHECK_BODY("zalloc-batch") {
+    void* ps[300];
+    const size_t n = mi_zalloc_batch(1000, 300, ps);
+    result = (n == 300);
+    for (size_t i = 0; i < n; i++) {
+      result = result && mem_is_zero((uint8_t*)ps[i], 1000);
+    }
+    for (size_t i = 0; i < n; i++) { mi_free(ps[i]); }
+  };
+  CHECK_BODY("free-batch") {
+    void* ps[1000];
+    for (size_t i = 0; i < 1000; i++) { ps[i] = mi_malloc(8 + (i%4)*16); }
+    ps[10] = NULL;
+    mi_free(ps[500]); ps[500] = mi_malloc_aligned(64, 128);
+    mi_free_batch(ps, 1000);
+  };
+  CHECK("free-batch-mt", test_free_batch_mt());
+  CHECK("heap-recycle-mt", test_heap_recycle_mt());
 
   // ---------------------------------------------------
   // Extended
@@ -320,6 +398,76 @@ int main(void) {
     mi_free(q);
   };
 
+  CHECK_BODY("realloc-grow-inplace") {
+    // growing a large block usually extends it in place into the following free slices
+    size_t size = 1024*1024;
+    uint8_t* p = (uint8_t*)mi_malloc(size);
+    memset(p, 0x5A, size);
+    size_t inplace = 0;
+    result = true;
+    for (int i = 0; i < 8 && result; i++) {
+      const size_t newsize = size + 256*1024;
+      uint8_t* q = (uint8_t*)mi_realloc(p, newsize);
+      if (q == p) inplace++;
+      for (size_t j = 0; j < size; j += 4096) { if (q[j] != 0x5A) result = false; }
+      memset(q + size, 0x5A, newsize - size);
+      p = q; size = newsize;
+    }
+    result = result && (inplace > 0) && (mi_usable_size(p) >= size);
+    mi_free(p);
+  };
+
+  CHECK_BODY("rezalloc-grow-inplace") {
+    // use a heap in a fresh exclusive arena so no other allocation ends up just after the block
+    mi_arena_id_t arena_id;
+    result = (mi_reserve_os_memory_ex(64*1024*1024, false /* commit */, false, true /* exclusive */, &arena_id) == 0);
+    mi_heap_t* heap = (result ? mi_heap_new_in_arena(arena_id) : NULL);
+    size_t size = 512*1024;
+    uint8_t* p = (heap != NULL ? (uint8_t*)mi_heap_zalloc(heap, size) : NULL);
+    result = (p != NULL);
+    for (int i = 0; i < 4 && result; i++) {
+      size *= 2;
+      uint8_t* q = (uint8_t*)mi_heap_rezalloc(heap, p, size);
+      result = (q == p && mem_is_zero(q, size));
+      p = q;
+    }
+    mi_free(p);
+    if (heap != NULL) { mi_heap_delete(heap); }
+  };
+
+  CHECK_BODY("realloc-huge") {
+    // huge blocks are resized by remapping their pages where supported
+    const long remap = mi_option_get(mi_option_huge_remap);
+    mi_option_enable(mi_option_huge_remap);
+    const size_t MiB = 1024*1024;
+    size_t size = 48*MiB;
+    uint8_t* p = (uint8_t*)mi_malloc(size);
+    for (size_t i = 0; i < size; i += MiB) { p[i] = (uint8_t)(i / MiB); }
+    result = true;
+    bool shrunk_in_place = false;
+    const size_t sizes[3] = { 200*MiB, 320*MiB, 40*MiB };
+    for (int k = 0; k < 3 && result && p != NULL; k++) {
+      const size_t newsize = sizes[k];
+      uint8_t* q = (uint8_t*)mi_realloc(p, newsize);
+      // shrinking a remapped block stays in place, while a copying realloc always returns a different block
+      if (newsize < size) { shrunk_in_place = (q == p); }
+      p = q;
+      const size_t n = (newsize < size ? newsize : size);
+      for (size_t i = 0; result && p != NULL && i < n; i += MiB) { result = (p[i] == (uint8_t)(i / MiB)); }
+      for (size_t i = n; p != NULL && i < newsize; i += MiB) { p[i] = (uint8_t)(i / MiB); }
+      size = newsize;
+    }
+    result = result && (p != NULL) && (mi_usable_size(p) >= size);
+    #if defined(__linux__)
+    // (huge blocks in a reserved OS region are not remappable)
+    result = result && (shrunk_in_place || mi_option_get(mi_option_os_region_reserve) != 0);
+    #else
+    (void)shrunk_in_place;
+    #endif
+    mi_free(p);
+    mi_option_set(mi_option_huge_remap, remap);
+  };
+
   CHECK_BODY("reallocarray-null-sizezero") {
     void* p = mi_reallocarray(NULL,0,16);  // issue #574
     result = (p != NULL && errno == 0);
@@ -331,6 +479,169 @@ int main(void) {
   // ---------------------------------------------------
   CHECK("heap_destroy", test_heap1());
   CHECK("heap_delete", test_heap2());
+  CHECK("heap_defrag", test_heap_defrag());
+  CHECK("heap_limit", test_heap_limit());
+
+  CHECK_BODY("heap-monotonic") {
+    mi_heap_t* heap = mi_heap_new_monotonic();
+    for (int i = 0; i < 1000 && result; i++) {
+      uint8_t* p = (uint8_t*)mi_heap_zalloc(heap, 40);
+      result = (p != NULL && p[0] == 0 && p[39] == 0 && mi_heap_check_owned(heap, p));
+      memset(p, 1, 40);
+      mi_free(p);  // ignored
+    }
+    void* big = mi_heap_malloc(heap, 1024*1024);
+    result = result && (big != NULL) && mi_heap_check_owned(heap, big);
+    // the freed small blocks are still in use
+    mi_frag_info_t info;
+    mi_heap_fragmentation_get(heap, &info);
+    size_t used = 0;
+    for (size_t i = 0; i < MI_BIN_HUGE; i++) { used += info.bins[i].used; }
+    result = result && (used == 1000);
+    mi_heap_destroy(heap);
+  };
+  CHECK_BODY("heap-monotonic-free-batch") {
+    mi_heap_t* heap = mi_heap_new_monotonic();
+    void* ps[100];
+    for (int i = 0; i < 100; i++) { ps[i] = mi_heap_malloc(heap, 32); }
+    mi_free_batch(ps, 100);  // ignored
+    mi_frag_info_t info;
+    mi_heap_fragmentation_get(heap, &info);
+    size_t used = 0;
+    for (size_t i = 0; i < MI_BIN_HUGE; i++) { used += info.bins[i].used; }
+    result = (used == 100);
+    mi_heap_destroy(heap);
+  };
+
+  CHECK_BODY("heap-reserve") {
+    void* ps[2000];
+    for (int mono = 0; mono <= 1 && result; mono++) {
+      mi_heap_t* heap = (mono ? mi_heap_new_monotonic() : mi_heap_new());
+      result = (mi_heap_reserve(heap, 64, 2000) == 0);
+      const size_t reserved = mi_heap_get_reserved(heap);
+      for (int i = 0; i < 2000 && result; i++) {
+        ps[i] = mi_heap_malloc(heap, 64);
+        result = (ps[i] != NULL);
+      }
+      // all blocks were allocated from the reserved pages
+      result = result && (reserved > 0) && (mi_heap_get_reserved(heap) == reserved);
+      result = result && (mi_heap_reserve(heap, 64, 1000) == 0) && (mi_heap_get_reserved(heap) > reserved);
+      result = result && (mi_heap_reserve(heap, 1024*1024, 1) == EINVAL);
+      mi_heap_destroy(heap);
+    }
+  };
+
+  CHECK_BODY("profile-dump") {
+    void* ps[1000];
+    for (int i = 0; i < 1000; i++) { ps[i] = mi_malloc(4096); }
+    const char* fname = "mimalloc-test-profile.txt";
+    const int err = mi_profile_dump(fname, mi_profile_format_pprof, false, 0);
+    if (err == 0) {
+      // profiling is compiled in
+      char line[64] = { 0 };
+      FILE* f = fopen(fname, "r");
+      result = (f != NULL && fgets(line, sizeof(line), f) != NULL && strncmp(line, "heap profile:", 13) == 0);
+      if (f != NULL) { fclose(f); }
+      result = result && (mi_profile_dump(fname, mi_profile_format_collapsed, true, 0) == 0);
+      remove(fname);
+    }
+    else {
+      result = (err == ENOTSUP);
+    }
+    for (int i = 0; i < 1000; i++) { mi_free(ps[i]); }
+  };
+  CHECK("profile-sampled", test_profile_sampled());
+
+  CHECK_BODY("heap-numa-node") {
+    mi_heap_t* heap = mi_heap_new_on_node(0);
+    void* p = mi_heap_malloc(heap, 100);
+    void* big = mi_heap_malloc(heap, 8*1024*1024);
+    result = (p != NULL && big != NULL && mi_heap_check_owned(heap, p) && mi_heap_check_owned(heap, big));
+    mi_free(big);
+    mi_free(p);
+    mi_heap_delete(heap);
+  };
+
+  CHECK_BODY("is-in-heap-region") {
+    int local = 0;
+    void* p = mi_malloc(100);
+    void* huge = mi_malloc(64*1024*1024);
+    result = (mi_is_in_heap_region(p) && mi_is_in_heap_region(huge) && !mi_is_in_heap_region(&local));
+    mi_free(huge);
+    mi_free(p);
+  };
+
+  CHECK_BODY("reserve-huge-async") {
+    // huge OS pages are often not available; either way the reservation should complete
+    const int err = mi_reserve_huge_os_pages_interleave_async(1, 1, 100);
+    const time_t start = time(NULL);
+    size_t reserved = 0;
+    int reserve_err = 0;
+    while (!mi_reserve_huge_os_pages_async_is_done(&reserved, &reserve_err) && time(NULL) - start < 30) { test_sleep(10); };
+    result = (mi_reserve_huge_os_pages_async_is_done(&reserved, &reserve_err) &&
+              (err == 0 || err == reserve_err) && (reserve_err != 0 || reserved == 1));
+  };
+
+  CHECK_BODY("arena-prefault") {
+    mi_arena_id_t arena_id;
+    result = (mi_reserve_os_memory_ex(256*1024*1024, true /* commit */, false, true /* exclusive */, &arena_id) == 0);
+    if (result) {
+      size_t size = 0;
+      void* area = mi_arena_area(arena_id, &size);
+      const int before = test_resident_percentage(area, size);
+      result = (mi_arena_prefault(arena_id, 4) == 0);
+      // the committed memory is now resident (where we can check that)
+      const int after = test_resident_percentage(area, size);
+      result = result && (after < 0 || (before < 50 && after == 100));
+      mi_heap_t* heap = mi_heap_new_in_arena(arena_id);
+      void* p = mi_heap_malloc(heap, 1024);
+      result = result && (p != NULL) && mi_heap_check_owned(heap, p);
+      mi_free(p);
+      mi_heap_delete(heap);
+    }
+    result = result && (mi_arena_prefault(12345, 1) == ENOENT);
+  };
+
+  CHECK_BODY("heap-fragmentation") {
+    mi_heap_t* heap = mi_heap_new();
+    void* ps[1000];
+    for (int i = 0; i < 1000; i++) { ps[i] = mi_heap_malloc(heap, 100); }
+    for (int i = 0; i < 1000; i += 2) { mi_free(ps[i]); }
+    mi_frag_info_t info;
+    mi_heap_fragmentation_get(heap, &info);
+    size_t used = 0;
+    size_t wasted = 0;
+    for (size_t i = 0; i <= MI_BIN_HUGE; i++) {
+      used += info.bins[i].used;
+      wasted += info.bins[i].wasted;
+      if (info.bins[i].used > 0) { result = (info.bins[i].block_size >= 100 && info.bins[i].page_count > 0); }
+    }
+    result = result && (used == 500) && (wasted >= 500*100);
+    char* json = mi_stats_get_json(0, NULL);
+    result = result && (json != NULL) && (strstr(json, "\"fragmentation\"") != NULL);
+    mi_free(json);
+    mi_heap_destroy(heap);
+  };
+
+  CHECK_BODY("size-classes") {
+    // good sizes are increasing and fit the request
+    size_t prev = 0;
+    for (size_t n = 1; n <= 4096 && result; n++) {
+      const size_t good = mi_good_size(n);
+      result = (good >= n && good >= prev);
+      prev = good;
+    }
+    // and any extra (aligned) size classes from the environment are exact
+    const char* s = getenv("MIMALLOC_SIZE_CLASSES");
+    while (s != NULL && *s != 0 && result) {
+      char* end;
+      const size_t size = (size_t)strtoul(s, &end, 10);
+      bool exact = false;
+      for (size_t n = 1; n <= size && !exact; n++) { exact = (mi_good_size(n) == size); }
+      result = (exact || size % MI_MAX_ALIGN_SIZE != 0);
+      s = (*end == ',' ? end + 1 : end);
+    }
+  };
 
   //mi_stats_print(NULL);
 
@@ -383,6 +694,253 @@ bool test_heap2(void) {
   return true;
 }
 
+// each block stores its index in the `slots` array so the move function can update the reference
+static bool test_defrag_move(const mi_heap_t* heap, void* block, size_t block_size, void* arg) {
+  void** slots = (void**)arg;
+  void* p = mi_heap_malloc((mi_heap_t*)heap, 64);
+  if (p == NULL) return false;
+  memcpy(p, block, (block_size < 64 ? block_size : 64));
+  slots[*(size_t*)p] = p;
+  mi_free(block);
+  return true;
+}
+
+typedef struct test_defrag_areas_s {
+  size_t count;
+  uint8_t* start[256];
+  uint8_t* end[256];
+} test_defrag_areas_t;
+
+static bool test_defrag_visit_area(const mi_heap_t* heap, const mi_heap_area_t* area, void* block, size_t block_size, void* arg) {
+  (void)(heap); (void)(block); (void)(block_size);
+  test_defrag_areas_t* areas = (test_defrag_areas_t*)arg;
+  if (areas->count >= 256) return false;
+  areas->start[areas->count] = (uint8_t*)area->blocks;
+  areas->end[areas->count] = (uint8_t*)area->blocks + area->reserved;
+  areas->count++;
+  return true;
+}
+
+static bool test_defrag_in_areas(const test_defrag_areas_t* areas, const void* p) {
+  for (size_t i = 0; i < areas->count; i++) {
+    if ((const uint8_t*)p >= areas->start[i] && (const uint8_t*)p < areas->end[i]) return true;
+  }
+  return false;
+}
+
+bool test_heap_defrag(void) {
+  const size_t N = 20000;
+  mi_heap_t* heap = mi_heap_new();
+  void** slots = (void**)mi_calloc(N, sizeof(void*));
+  for (size_t i = 0; i < N; i++) {
+    slots[i] = mi_heap_malloc(heap, 64);
+    *(size_t*)slots[i] = i;
+  }
+  // keep only every 10th block in the first half (sparse pages), and almost all blocks in
+  // the second half (dense pages with fewer free blocks than need to be moved)
+  for (size_t i = 0; i < N; i++) {
+    if (i < N/2 ? i % 10 != 0 : i % 50 == 0) { mi_free(slots[i]); slots[i] = NULL; }
+  }
+  bool ok = mi_heap_page_is_underutilized(heap, slots[0], 0.5);
+  // remember the areas of the sparse pages in the first half
+  test_defrag_areas_t all;
+  test_defrag_areas_t sparse;
+  memset(&all, 0, sizeof(all));
+  memset(&sparse, 0, sizeof(sparse));
+  mi_heap_visit_blocks(heap, false, &test_defrag_visit_area, &all);
+  for (size_t i = 0; i < all.count; i++) {
+    // find a block of the first half in this area
+    size_t j = 0;
+    while (j < N/2 && !((uint8_t*)slots[j] >= all.start[i] && (uint8_t*)slots[j] < all.end[i])) { j += 10; }
+    if (j < N/2 && mi_heap_page_is_underutilized(heap, slots[j], 0.5)) {
+      sparse.start[sparse.count] = all.start[i];
+      sparse.end[sparse.count] = all.end[i];
+      sparse.count++;
+    }
+  }
+  ok = ok && (sparse.count > 0);
+  const size_t freed = mi_heap_defrag(heap, 0.5, &test_defrag_move, slots);
+  ok = ok && (freed >= sparse.count);
+  for (size_t i = 0; i < N; i++) {
+    if (slots[i] == NULL) continue;
+    ok = ok && (*(size_t*)slots[i] == i) && mi_heap_contains_block(heap, slots[i]);
+    // no block was moved into a page that was being emptied
+    ok = ok && !test_defrag_in_areas(&sparse, slots[i]);
+  }
+  ok = ok && !mi_heap_page_is_underutilized(heap, &ok, 0.5);  // not a block in the heap
+  mi_heap_destroy(heap);
+  mi_free(slots);
+  return ok;
+}
+
+typedef struct test_limit_s {
+  void** slots;
+  size_t count;
+  size_t calls;
+} test_limit_t;
+
+static bool test_limit_evict(mi_heap_t* heap, size_t limit, size_t reserved, size_t size, void* arg) {
+  (void)(heap); (void)(size);
+  test_limit_t* lim = (test_limit_t*)arg;
+  lim->calls++;
+  if (reserved + 64*1024 <= limit || lim->count == 0) return false;
+  // evict the oldest half
+  const size_t n = lim->count / 2;
+  for (size_t i = 0; i < n; i++) { mi_free(lim->slots[i]); }
+  memmove(lim->slots, lim->slots + n, (lim->count - n) * sizeof(void*));
+  lim->count -= n;
+  return true;
+}
+
+bool test_heap_limit(void) {
+  const size_t N = 4000;
+  const size_t limit = 1024*1024;
+  mi_heap_t* heap = mi_heap_new();
+  test_limit_t lim = { (void**)mi_calloc(N, sizeof(void*)), 0, 0 };
+  // without a limit function, allocation fails once the limit is reached
+  mi_heap_set_limit(heap, limit, NULL, NULL);
+  void* p;
+  while (lim.count < N && (p = mi_heap_malloc(heap, 1000)) != NULL) { lim.slots[lim.count++] = p; }
+  bool ok = (lim.count > 0 && lim.count < N && mi_heap_get_reserved(heap) <= limit);
+  // with a limit function, memory is evicted and allocation continues
+  mi_heap_set_limit(heap, limit, &test_limit_evict, &lim);
+  for (size_t i = 0; i < N && ok; i++) {
+    p = mi_heap_malloc(heap, 1000);
+    ok = (p != NULL && lim.count < N && mi_heap_get_reserved(heap) <= limit);
+    if (ok) { lim.slots[lim.count++] = p; }
+  }
+  ok = ok && (lim.calls > 0);
+  for (size_t i = 0; i < lim.count; i++) { mi_free(lim.slots[i]); }
+  mi_heap_collect(heap, true);
+  ok = ok && (mi_heap_get_reserved(heap) == 0);
+  mi_heap_delete(heap);
+  mi_free(lim.slots);
+  // monotonic heaps call the limit function as well before failing
+  mi_heap_t* mheap = mi_heap_new_monotonic();
+  test_limit_t mlim = { NULL, 0, 0 };
+  mi_heap_set_limit(mheap, limit, &test_limit_evict, &mlim);
+  size_t mcount = 0;
+  while (mcount < 4*N && mi_heap_malloc(mheap, 1000) != NULL) { mcount++; }
+  ok = ok && (mcount > 0 && mcount < 4*N && mlim.calls > 0 && mi_heap_get_reserved(mheap) <= limit);
+  mi_heap_destroy(mheap);
+  return ok;
+}
+
+// sum the estimated bytes of the (live or cumulative) collapsed heap profile
+static size_t test_profile_bytes(bool cumulative) {
+  const char* fname = "mimalloc-test-profile.txt";
+  if (mi_profile_dump(fname, mi_profile_format_collapsed, cumulative, 0) != 0) return 0;
+  size_t total = 0;
+  char line[2048];
+  FILE* f = fopen(fname, "r");
+  while (f != NULL && fgets(line, sizeof(line), f) != NULL) {
+    const char* bytes = strrchr(line, ' ');
+    if (bytes != NULL) { total += (size_t)strtoull(bytes + 1, NULL, 10); }
+  }
+  if (f != NULL) { fclose(f); }
+  remove(fname);
+  return total;
+}
+
+bool test_profile_sampled(void) {
+  if (mi_profile_dump("mimalloc-test-profile.txt", mi_profile_format_collapsed, false, 0) == ENOTSUP) return true;
+  remove("mimalloc-test-profile.txt");
+  const size_t MiB = 1024*1024;
+  // blocks drained from a page by a batch allocation are sampled as well
+  void** ps = (void**)mi_malloc(MiB * sizeof(void*));
+  size_t live = test_profile_bytes(false);
+  const size_t n = mi_malloc_batch(64, MiB, ps);
+  bool ok = (n == MiB && test_profile_bytes(false) >= live + 32*MiB);
+  for (size_t i = 0; i < n; i++) { mi_free(ps[i]); }
+  mi_free(ps);
+  // a sampled huge block that moves on `mi_realloc` is still removed from the profile when it is freed
+  const long remap = mi_option_get(mi_option_huge_remap);
+  mi_option_enable(mi_option_huge_remap);
+  live = test_profile_bytes(false);
+  void* p = mi_malloc(256*MiB);
+  p = mi_realloc(p, 1024*MiB);
+  ok = ok && (p != NULL && test_profile_bytes(false) >= live + 512*MiB);
+  mi_free(p);
+  ok = ok && (test_profile_bytes(false) < live + 128*MiB);
+  mi_option_set(mi_option_huge_remap, remap);
+  return ok;
+}
+
+bool test_free_batch_mt(void) {
+#ifdef __cplusplus
+  // allocate in one thread and free the whole batch from another
+  void* ps[2000];
+  const size_t n = mi_malloc_batch(48, 2000, ps);
+  std::thread t([&]() { mi_free_batch(ps, n); });
+  t.join();
+  mi_collect(true);
+  return (n == 2000);
+#else
+  return true;
+#endif
+}
+
+// run `fn(arg)` in a new thread and wait for it to finish; returns `false` if threads are not supported
+static bool test_run_thread(void* (*fn)(void*), void* arg) {
+#if defined(__cplusplus)
+  std::thread t([&]() { fn(arg); });
+  t.join();
+  return true;
+#elif !defined(_WIN32)
+  pthread_t t;
+  if (pthread_create(&t, NULL, fn, arg) != 0) return false;
+  pthread_join(t, NULL);
+  return true;
+#else
+  (void)(fn); (void)(arg);
+  return false;
+#endif
+}
+
+typedef struct test_recycle_s {
+  void*      ps[100];
+  mi_heap_t* heap1;
+  bool       ok;
+} test_recycle_t;
+
+static void* test_recycle_alloc(void* arg) {
+  test_recycle_t* tr = (test_recycle_t*)arg;
+  tr->heap1 = mi_heap_get_backing();
+  for (int i = 0; i < 100; i++) { tr->ps[i] = mi_malloc(64); }
+  return NULL;
+}
+
+static void* test_recycle_adopt(void* arg) {
+  test_recycle_t* tr = (test_recycle_t*)arg;
+  // the heap of the first thread was adopted: before any allocation or free, our heap already owns its pages
+  // (an abandoned segment would only be reclaimed later, by an allocation or free)
+  tr->ok = (mi_heap_get_backing() == tr->heap1) && mi_heap_check_owned(mi_heap_get_backing(), tr->ps[1]);
+  for (int i = 0; i < 100; i += 2) { mi_free(tr->ps[i]); }
+  void* p = mi_malloc(64);
+  tr->ok = tr->ok && (p != NULL) && mi_check_owned(p);
+  // and the block is allocated in a segment of the first thread
+  tr->ok = tr->ok && (((uintptr_t)p & ~(MI_SEGMENT_ALIGN - 1)) == ((uintptr_t)tr->ps[0] & ~(MI_SEGMENT_ALIGN - 1)));
+  mi_free(p);
+  return NULL;
+}
+
+bool test_heap_recycle_mt(void) {
+  // objects allocated by an exited thread stay valid when its heap is parked and adopted by a later thread
+  const long recycle = mi_option_get(mi_option_heap_recycle);
+  mi_option_set(mi_option_heap_recycle, 4);
+  mi_collect(true);  // abandon any heaps that are still parked
+  test_recycle_t tr;
+  memset(&tr, 0, sizeof(tr));
+  bool ok = true;
+  if (test_run_thread(&test_recycle_alloc, &tr) && test_run_thread(&test_recycle_adopt, &tr)) {
+    ok = tr.ok;
+    for (int i = 1; i < 100; i += 2) { mi_free(tr.ps[i]); }
+  }
+  mi_collect(true);
+  mi_option_set(mi_option_heap_recycle, recycle);
+  return ok;
+}
+
 bool test_stl_allocator1(void) {
 #ifdef __cplusplus
   std::vector<int, mi_stl_allocator<int> > vec;
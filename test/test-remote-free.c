@@ -0,0 +1,188 @@
+/* ----------------------------------------------------------------------------
+Copyright (c) 2018-2024 Microsoft Research, Daan Leijen
+This is free software; you can redistribute it and/or modify it under the
+terms of the MIT license.
+-----------------------------------------------------------------------------*/
+
+/* Producer/consumer benchmark for non-local frees:
+   - the main thread (producer) allocates a batch of small objects,
+   - then CONSUMERS threads free those objects concurrently, interleaved so
+     all consumers free into the same pages at the same time.
+   Each round is run with `mi_option_remote_free_buffer` disabled and enabled;
+   with buffering each consumer publishes a chain of frees per page with a single
+   CAS instead of contending on the page `xthread_free` field for every block.
+   The consumers are started before each round and wait until all of them are
+   ready, so only the free phase is timed (and not thread creation and exit).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <mimalloc.h>
+
+// > mimalloc-test-remote-free [CONSUMERS] [ITEMS] [ROUNDS] [BUFFER]
+static int CONSUMERS = 8;
+static int ITEMS     = 100000;   // objects allocated per round
+static int ROUNDS    = 10;
+static int BUFFER    = 32;       // value for `mi_option_remote_free_buffer` when enabled
+
+static void** items;
+
+static volatile intptr_t ready;   // consumers that are waiting to start
+static volatile intptr_t go;      // set to start freeing
+static volatile intptr_t done;    // consumers that are done freeing
+
+static void start_os_threads(size_t nthreads, void (*fun)(intptr_t));
+static void join_os_threads(void);
+static intptr_t atomic_add(volatile intptr_t* p, intptr_t x);
+static void thread_yield(void);
+
+static void consume(intptr_t tid) {
+  atomic_add(&ready, 1);
+  while (atomic_add(&go, 0) == 0) { thread_yield(); }
+  for (size_t i = (size_t)tid; i < (size_t)ITEMS; i += (size_t)CONSUMERS) {
+    mi_free(items[i]);
+  }
+  mi_collect(false);  // publish any buffered frees
+  atomic_add(&done, 1);
+}
+
+static double now_msecs(void) {
+  struct timespec t;
+  timespec_get(&t, TIME_UTC);
+  return ((double)t.tv_sec * 1000.0) + ((double)t.tv_nsec / 1000000.0);
+}
+
+static double run(long buffer) {
+  mi_option_set(mi_option_remote_free_buffer, buffer);
+  double elapsed = 0.0;
+  for (int r = 0; r < ROUNDS; r++) {
+    const size_t n = mi_malloc_batch(64, (size_t)ITEMS, items);
+    if (n != (size_t)ITEMS) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+    ready = 0; go = 0; done = 0;
+    start_os_threads((size_t)CONSUMERS, &consume);
+    while (atomic_add(&ready, 0) < CONSUMERS) { thread_yield(); }
+    const double start = now_msecs();
+    atomic_add(&go, 1);
+    while (atomic_add(&done, 0) < CONSUMERS) { thread_yield(); }
+    elapsed += now_msecs() - start;
+    join_os_threads();
+    mi_collect(false);   // collect the (now free) pages in the producer
+  }
+  return elapsed;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 2) { char* end; long n = strtol(argv[1], &end, 10); if (n > 0) CONSUMERS = (int)n; }
+  if (argc >= 3) { char* end; long n = strtol(argv[2], &end, 10); if (n > 0) ITEMS = (int)n; }
+  if (argc >= 4) { char* end; long n = strtol(argv[3], &end, 10); if (n > 0) ROUNDS = (int)n; }
+  if (argc >= 5) { char* end; long n = strtol(argv[4], &end, 10); if (n > 1) BUFFER = (int)n; }
+  printf("Using %d consumers, %d items, %d rounds, buffer %d\n", CONSUMERS, ITEMS, ROUNDS, BUFFER);
+
+  items = (void**)mi_calloc((size_t)ITEMS, sizeof(void*));
+  const double direct   = run(0);
+  const double buffered = run(BUFFER);
+  mi_free(items);
+  mi_collect(true);
+
+  printf("direct free:   %8.2f ms\n", direct);
+  printf("buffered free: %8.2f ms\n", buffered);
+  return 0;
+}
+
+
+static void (*thread_entry_fun)(intptr_t) = &consume;
+
+#ifdef _WIN32
+
+#include <windows.h>
+
+static HANDLE* thandles;
+static size_t  thread_count;
+
+static DWORD WINAPI thread_entry(LPVOID param) {
+  thread_entry_fun((intptr_t)param);
+  return 0;
+}
+
+static void start_os_threads(size_t nthreads, void (*fun)(intptr_t)) {
+  thread_entry_fun = fun;
+  thread_count = nthreads;
+  thandles = (HANDLE*)mi_calloc(nthreads,sizeof(HANDLE));
+  for (size_t i = 0; i < nthreads; i++) {
+    thandles[i] = CreateThread(0, 8*1024, &thread_entry, (void*)(i), 0, NULL);
+  }
+}
+
+static void join_os_threads(void) {
+  for (size_t i = 0; i < thread_count; i++) {
+    WaitForSingleObject(thandles[i], INFINITE);
+    CloseHandle(thandles[i]);
+  }
+  mi_free(thandles);
+}
+
+static intptr_t atomic_add(volatile intptr_t* p, intptr_t x) {
+#if (INTPTR_MAX == INT32_MAX)
+  return (intptr_t)InterlockedExchangeAdd((volatile LONG*)p, (LONG)x);
+#else
+  return (intptr_t)InterlockedExchangeAdd64((volatile LONG64*)p, (LONG64)x);
+#endif
+}
+
+static void thread_yield(void) {
+  SwitchToThread();
+}
+
+#else
+
+#include <pthread.h>
+#include <sched.h>
+
+static pthread_t* threads;
+static size_t     thread_count;
+
+static void* thread_entry(void* param) {
+  thread_entry_fun((uintptr_t)param);
+  return NULL;
+}
+
+static void start_os_threads(size_t nthreads, void (*fun)(intptr_t)) {
+  thread_entry_fun = fun;
+  thread_count = nthreads;
+  threads = (pthread_t*)mi_calloc(nthreads,sizeof(pthread_t));
+  for (size_t i = 0; i < nthreads; i++) {
+    pthread_create(&threads[i], NULL, &thread_entry, (void*)i);
+  }
+}
+
+static void join_os_threads(void) {
+  for (size_t i = 0; i < thread_count; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  mi_free(threads);
+}
+
+#ifdef __cplusplus
+#include <atomic>
+static intptr_t atomic_add(volatile intptr_t* p, intptr_t x) {
+  return std::atomic_fetch_add((volatile std::atomic<intptr_t>*)p, x);
+}
+#else
+#include <stdatomic.h>
+static intptr_t atomic_add(volatile intptr_t* p, intptr_t x) {
+  return atomic_fetch_add((volatile _Atomic(intptr_t)*)p, x);
+}
+#endif
+
+static void thread_yield(void) {
+  sched_yield();
+}
+
+#endif